@@ -16,6 +16,20 @@ if [ -d "build" ]; then
 fi
 $PYTHON setup.py build_ext --inplace
 
+echo "Building img transform op..."
+cd ../img_transform
+if [ -d "build" ]; then
+    rm -r build
+fi
+$PYTHON setup.py build_ext --inplace
+
+echo "Building tta merge op..."
+cd ../tta_merge
+if [ -d "build" ]; then
+    rm -r build
+fi
+$PYTHON setup.py build_ext --inplace
+
 echo "Building nms op..."
 cd ../nms
 make clean
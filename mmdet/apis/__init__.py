@@ -1,8 +1,9 @@
 from .env import init_dist, get_root_logger, set_random_seed
 from .train import train_detector
 from .inference import inference_detector, show_result
+from .pipeline import pipelined_test
 
 __all__ = [
     'init_dist', 'get_root_logger', 'set_random_seed', 'train_detector',
-    'inference_detector', 'show_result'
+    'inference_detector', 'show_result', 'pipelined_test'
 ]
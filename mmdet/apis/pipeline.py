@@ -0,0 +1,284 @@
+from __future__ import division
+
+import sys
+import threading
+import time
+
+import mmcv
+import torch
+from six.moves import queue
+
+from mmdet.core import resolve_deferred
+from mmdet.ops.autotune import autotuner
+
+_END = object()
+
+
+class StageStats(object):
+    """Latency and throughput of a pipeline stage."""
+
+    def __init__(self, name, num_workers):
+        self.name = name
+        self.num_workers = num_workers
+        self.count = 0
+        self.total_time = 0.
+        self.max_time = 0.
+        self.first_start = None
+        self.last_end = None
+        self._lock = threading.Lock()
+
+    def add(self, start, end):
+        with self._lock:
+            self.count += 1
+            self.total_time += end - start
+            self.max_time = max(self.max_time, end - start)
+            if self.first_start is None or start < self.first_start:
+                self.first_start = start
+            if self.last_end is None or end > self.last_end:
+                self.last_end = end
+
+    @property
+    def mean_time(self):
+        return self.total_time / self.count if self.count else 0.
+
+    @property
+    def throughput(self):
+        """Items per second while the stage was active."""
+        if not self.count or self.last_end <= self.first_start:
+            return 0.
+        return self.count / (self.last_end - self.first_start)
+
+    @property
+    def utilization(self):
+        """Fraction of the active time the workers were busy."""
+        if not self.count or self.last_end <= self.first_start:
+            return 0.
+        return self.total_time / (
+            self.num_workers * (self.last_end - self.first_start))
+
+
+class _Abort(Exception):
+    pass
+
+
+class Pipeline(object):
+    """Run the items of an iterable through stages of worker threads.
+
+    The first stage ("load") is a single thread that draws the items from
+    ``source`` and applies ``prepare`` to them. Each following stage is a
+    ``(name, func, num_workers)`` tuple. Stages are connected by queues of
+    at most ``queue_size`` items, so a slow stage throttles the ones before
+    it instead of buffering the whole dataset.
+
+    Iterating over the pipeline yields ``(index, output)`` pairs in order of
+    completion, which differs from the input order if a stage has several
+    workers. An exception in any stage stops the pipeline and is raised
+    by the iteration. All the workers have stopped when the iteration ends,
+    whether it completes, fails or is closed early.
+    """
+
+    def __init__(self, source, stages, prepare=None, queue_size=4):
+        self.source = source
+        self.stages = stages
+        self.prepare = prepare
+        self.queue_size = queue_size
+        self.stats = [StageStats('load', 1)] + [
+            StageStats(name, num_workers) for name, _, num_workers in stages
+        ]
+        self._error = None
+        self._failed = threading.Event()
+
+    def _put(self, q, item):
+        while True:
+            try:
+                q.put(item, timeout=0.1)
+                return
+            except queue.Full:
+                if self._failed.is_set():
+                    raise _Abort()
+
+    def _get(self, q):
+        while True:
+            try:
+                return q.get(timeout=0.1)
+            except queue.Empty:
+                if self._failed.is_set():
+                    raise _Abort()
+
+    def _guard(self, func, *args):
+        try:
+            func(*args)
+        except _Abort:
+            pass
+        except Exception:
+            if not self._failed.is_set():
+                self._error = sys.exc_info()[1]
+                self._failed.set()
+
+    def _feed(self, out_queue, num_consumers):
+        stats = self.stats[0]
+        items = iter(self.source)
+        i = 0
+        while True:
+            start = time.time()
+            try:
+                item = next(items)
+            except StopIteration:
+                break
+            if self.prepare is not None:
+                item = self.prepare(item)
+            stats.add(start, time.time())
+            self._put(out_queue, (i, item))
+            i += 1
+        for _ in range(num_consumers):
+            self._put(out_queue, _END)
+
+    def _work(self, func, stats, in_queue, out_queue, done, num_consumers):
+        while True:
+            item = self._get(in_queue)
+            if item is _END:
+                break
+            i, data = item
+            start = time.time()
+            output = func(data)
+            stats.add(start, time.time())
+            self._put(out_queue, (i, output))
+        # the last worker of a stage to finish ends the next stage
+        with done['lock']:
+            done['workers'] -= 1
+            last = done['workers'] == 0
+        if last:
+            for _ in range(num_consumers):
+                self._put(out_queue, _END)
+
+    def __iter__(self):
+        queues = [
+            queue.Queue(self.queue_size) for _ in range(len(self.stages) + 1)
+        ]
+        # the consumers of every queue, the caller consumes the last one
+        consumers = [num_workers for _, _, num_workers in self.stages] + [1]
+        threads = [
+            threading.Thread(
+                target=self._guard,
+                args=(self._feed, queues[0], consumers[0]))
+        ]
+        for i, (_, func, num_workers) in enumerate(self.stages):
+            done = dict(lock=threading.Lock(), workers=num_workers)
+            for _ in range(num_workers):
+                threads.append(
+                    threading.Thread(
+                        target=self._guard,
+                        args=(self._work, func, self.stats[i + 1], queues[i],
+                              queues[i + 1], done, consumers[i + 1])))
+        for thread in threads:
+            thread.daemon = True
+            thread.start()
+
+        try:
+            while True:
+                item = self._get(queues[-1])
+                if item is _END:
+                    break
+                yield item
+        except _Abort:
+            raise self._error
+        finally:
+            # stop the workers if the caller stops early, and wait for them
+            # so that none of them outlives the iteration
+            self._failed.set()
+            for thread in threads:
+                thread.join()
+
+    def summary(self, wall_time, num_items):
+        lines = [
+            '{:<8}{:>8}{:>8}{:>16}{:>15}{:>12}'.format(
+                'stage', 'workers', 'items', 'mean/max (ms)', 'items/s',
+                'busy'),
+        ]
+        for s in self.stats:
+            lines.append('{:<8}{:>8}{:>8}{:>16}{:>15.2f}{:>11.0f}%'.format(
+                s.name, s.num_workers, s.count, '{:.1f}/{:.1f}'.format(
+                    s.mean_time * 1000, s.max_time * 1000), s.throughput,
+                s.utilization * 100))
+        lines.append('total: {} items in {:.1f} s, {:.2f} items/s'.format(
+            num_items, wall_time,
+            num_items / wall_time if wall_time > 0 else 0.))
+        return '\n'.join(lines)
+
+
+def pipelined_test(model,
+                   data_loader,
+                   rescale=True,
+                   infer_workers=1,
+                   post_workers=2,
+                   queue_size=4):
+    """Test a model with data loading, inference and post-processing
+    overlapped.
+
+    The stages are:
+
+    - load: the data loader (with its own worker processes) and the copy of
+      the inputs to the GPU.
+    - infer: the forward pass. Several workers share the model, nothing is
+      autotuned then since the workers would time each other (the tuned
+      configurations in the cache are still used).
+    - post: host side post-processing the model leaves to the end, i.e.
+      splitting the boxes by class and resizing and encoding masks.
+
+    The results are the same, and in the same order, as with a sequential
+    loop over the data loader (see ``tools/check_pipeline.py``). Per-stage
+    statistics are printed at the end.
+
+    Args:
+        model (MMDataParallel): the model on a single GPU.
+        data_loader (DataLoader): a test data loader.
+        rescale (bool): rescale the results to the original images.
+        infer_workers (int): threads running the forward pass.
+        post_workers (int): threads running the post-processing.
+        queue_size (int): the maximum number of images waiting between two
+            stages.
+
+    Returns:
+        list: the results of all images.
+    """
+    model.eval()
+    detector = model.module
+    dataset = data_loader.dataset
+
+    def prepare(data):
+        _, kwargs = model.scatter((), data, model.device_ids)
+        return kwargs[0]
+
+    def infer(data):
+        # the grad mode is thread local
+        with torch.no_grad():
+            return detector(return_loss=False, rescale=rescale, **data)
+
+    pipeline = Pipeline(
+        data_loader, [('infer', infer, infer_workers),
+                      ('post', resolve_deferred, post_workers)],
+        prepare=prepare,
+        queue_size=queue_size)
+
+    results = [None] * len(dataset)
+    prog_bar = mmcv.ProgressBar(len(dataset))
+    start = time.time()
+    # the detector and the autotuner are shared by the infer workers, they
+    # are set up before the workers start and restored after all of them
+    # have stopped
+    tune = autotuner.enabled
+    detector.defer_postprocess = True
+    if infer_workers > 1:
+        autotuner.enabled = False
+    try:
+        # one image per batch, the batch index is the image index
+        for i, result in pipeline:
+            results[i] = result
+            prog_bar.update()
+    finally:
+        detector.defer_postprocess = False
+        autotuner.enabled = tune
+    wall_time = time.time() - start
+
+    print('\n' + pipeline.summary(wall_time, len(dataset)))
+    return results
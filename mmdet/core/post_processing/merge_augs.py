@@ -4,6 +4,19 @@ import numpy as np
 
 from mmdet.ops import nms
 from ..bbox import bbox_mapping_back
+from .bbox_nms import multiclass_nms
+
+# the native op maps back, averages and suppresses the results of all
+# augmentations at once. It is used if it is compiled and enabled with
+# `native_merge=True` in the test config, otherwise the Python code below is.
+try:
+    from mmdet.ops import tta_merge
+except ImportError:
+    tta_merge = None
+
+
+def _native(test_cfg):
+    return tta_merge is not None and test_cfg.get('native_merge', False)
 
 
 def merge_aug_proposals(aug_proposals, img_metas, rpn_test_cfg):
@@ -19,6 +32,11 @@ def merge_aug_proposals(aug_proposals, img_metas, rpn_test_cfg):
     Returns:
         Tensor: shape (n, 4), proposals corresponding to original image scale.
     """
+    if _native(rpn_test_cfg):
+        return tta_merge.merge_proposals(aug_proposals,
+                                         tta_merge.aug_meta(img_metas),
+                                         rpn_test_cfg.nms_thr,
+                                         rpn_test_cfg.max_num)
     recovered_proposals = []
     for proposals, img_info in zip(aug_proposals, img_metas):
         img_shape = img_info['img_shape']
@@ -38,7 +56,11 @@ def merge_aug_proposals(aug_proposals, img_metas, rpn_test_cfg):
     return merged_proposals
 
 
-def merge_aug_bboxes(aug_bboxes, aug_scores, img_metas, rcnn_test_cfg):
+def merge_aug_bboxes(aug_bboxes,
+                     aug_scores,
+                     img_metas,
+                     rcnn_test_cfg,
+                     weights=None):
     """Merge augmented detection bboxes and scores.
 
     Args:
@@ -46,10 +68,17 @@ def merge_aug_bboxes(aug_bboxes, aug_scores, img_metas, rcnn_test_cfg):
         aug_scores (list[Tensor] or None): shape (n, #class)
         img_shapes (list[Tensor]): shape (3, ).
         rcnn_test_cfg (dict): rcnn test config.
+        weights (list[float], optional): weights of the augmentations.
 
     Returns:
         tuple: (bboxes, scores)
     """
+    if _native(rcnn_test_cfg):
+        meta = tta_merge.aug_meta([img_info[0] for img_info in img_metas])
+        bboxes = tta_merge.merge_mapped_bboxes(aug_bboxes, meta, weights)
+        if aug_scores is None:
+            return bboxes
+        return bboxes, tta_merge.merge_maps(aug_scores, weights=weights)
     recovered_bboxes = []
     for bboxes, img_info in zip(aug_bboxes, img_metas):
         img_shape = img_info[0]['img_shape']
@@ -57,20 +86,49 @@ def merge_aug_bboxes(aug_bboxes, aug_scores, img_metas, rcnn_test_cfg):
         flip = img_info[0]['flip']
         bboxes = bbox_mapping_back(bboxes, img_shape, scale_factor, flip)
         recovered_bboxes.append(bboxes)
-    bboxes = torch.stack(recovered_bboxes).mean(dim=0)
+    bboxes = _average(torch.stack(recovered_bboxes), weights)
     if aug_scores is None:
         return bboxes
     else:
-        scores = torch.stack(aug_scores).mean(dim=0)
+        scores = _average(torch.stack(aug_scores), weights)
         return bboxes, scores
 
 
-def merge_aug_scores(aug_scores):
+def merge_aug_dets(aug_bboxes, aug_scores, img_metas, rcnn_test_cfg,
+                   weights=None):
+    """Merge augmented detection bboxes and scores and suppress them, i.e.
+    :func:`merge_aug_bboxes` followed by :func:`multiclass_nms`.
+
+    With ``native_merge=True`` and a plain NMS this is a single native call
+    over all augmentations. The suppression then follows the CPU NMS also
+    for CUDA inputs, which may only differ from the GPU NMS for boxes with
+    an IoU of exactly the threshold.
+
+    Returns:
+        tuple: (bboxes, labels), tensors of shape (k, 5) and (k, ).
+    """
+    nms_cfg = rcnn_test_cfg.nms
+    if _native(rcnn_test_cfg) and nms_cfg.get('type', 'nms') == 'nms':
+        meta = tta_merge.aug_meta([img_info[0] for img_info in img_metas])
+        return tta_merge.merge_dets(aug_bboxes, aug_scores, meta,
+                                    rcnn_test_cfg.score_thr,
+                                    nms_cfg['iou_thr'],
+                                    rcnn_test_cfg.max_per_img, weights)
+    merged_bboxes, merged_scores = merge_aug_bboxes(
+        aug_bboxes, aug_scores, img_metas, rcnn_test_cfg, weights)
+    return multiclass_nms(merged_bboxes, merged_scores,
+                          rcnn_test_cfg.score_thr, nms_cfg,
+                          rcnn_test_cfg.max_per_img)
+
+
+def merge_aug_scores(aug_scores, weights=None, native_merge=False):
     """Merge augmented bbox scores."""
+    if tta_merge is not None and native_merge:
+        return tta_merge.merge_maps(aug_scores, weights=weights)
     if isinstance(aug_scores[0], torch.Tensor):
-        return torch.mean(torch.stack(aug_scores), dim=0)
+        return _average(torch.stack(aug_scores), weights)
     else:
-        return np.mean(aug_scores, axis=0)
+        return np.average(aug_scores, axis=0, weights=weights)
 
 
 def merge_aug_masks(aug_masks, img_metas, rcnn_test_cfg, weights=None):
@@ -84,6 +142,9 @@ def merge_aug_masks(aug_masks, img_metas, rcnn_test_cfg, weights=None):
     Returns:
         tuple: (bboxes, scores)
     """
+    if _native(rcnn_test_cfg):
+        flips = [img_info[0]['flip'] for img_info in img_metas]
+        return tta_merge.merge_maps(aug_masks, flips, weights)
     recovered_masks = [
         mask if not img_info[0]['flip'] else mask[..., ::-1]
         for mask, img_info in zip(aug_masks, img_metas)
@@ -94,3 +155,11 @@ def merge_aug_masks(aug_masks, img_metas, rcnn_test_cfg, weights=None):
         merged_masks = np.average(
             np.array(recovered_masks), axis=0, weights=np.array(weights))
     return merged_masks
+
+
+def _average(stacked, weights=None):
+    if weights is None:
+        return stacked.mean(dim=0)
+    weights = stacked.new_tensor(weights).view(-1, *[1] *
+                                               (stacked.dim() - 1))
+    return (stacked * weights).sum(dim=0) / weights.sum()
@@ -35,3 +35,26 @@ def unmap(data, count, inds, fill=0):
         ret = data.new_full(new_size, fill)
         ret[inds, :] = data
     return ret
+
+
+class Deferred(object):
+    """A part of a result whose computation is postponed, e.g. host side
+    post-processing that is run by another thread later."""
+
+    def __init__(self, func, *args, **kwargs):
+        self.func = partial(func, *args, **kwargs)
+
+    def __call__(self):
+        return self.func()
+
+
+def resolve_deferred(result):
+    """Replace the :class:`Deferred` parts of a (nested) result with their
+    values."""
+    if isinstance(result, Deferred):
+        return result()
+    elif isinstance(result, (tuple, list)):
+        return type(result)(resolve_deferred(r) for r in result)
+    elif isinstance(result, dict):
+        return {k: resolve_deferred(v) for k, v in result.items()}
+    return result
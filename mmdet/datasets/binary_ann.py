@@ -0,0 +1,248 @@
+import json
+import struct
+from collections import Sequence
+
+import numpy as np
+
+__all__ = [
+    'dump_binary_annotations', 'dump_binary_proposals', 'BinaryAnnotations',
+    'BinaryProposals'
+]
+
+_MAGIC = b'MMDETBIN'
+_VERSION = 1
+_ALIGN = 64
+
+
+def _align(offset):
+    return (offset + _ALIGN - 1) // _ALIGN * _ALIGN
+
+
+def _concat(arrays, dtype, width=None):
+    """Concatenate per-image arrays into one column plus an offset index.
+
+    Returns:
+        tuple: (data, offsets), the rows of the i-th image are
+            ``data[offsets[i]:offsets[i + 1]]``.
+    """
+    offsets = np.zeros(len(arrays) + 1, dtype=np.int64)
+    offsets[1:] = np.cumsum([len(arr) for arr in arrays])
+    shape = (0, ) if width is None else (0, width)
+    rows = [np.asarray(arr, dtype=dtype).reshape((-1, ) + shape[1:])
+            for arr in arrays]
+    data = np.concatenate(rows) if rows else np.zeros(shape, dtype=dtype)
+    return data, offsets
+
+
+def _write(out_file, kind, num_imgs, columns):
+    """Write columns to a single file.
+
+    Layout: magic (8 bytes), version and header size (2 x uint32), a json
+    header describing every column, then the raw columns, each aligned to 64
+    bytes so that they can be mapped as typed arrays directly.
+    """
+    meta = {}
+    offset = 0
+    for name, arr in columns.items():
+        arr = np.ascontiguousarray(arr)
+        columns[name] = arr
+        meta[name] = dict(
+            dtype=arr.dtype.str, shape=list(arr.shape), offset=offset)
+        offset = _align(offset + arr.nbytes)
+    header = json.dumps(
+        dict(kind=kind, num_imgs=num_imgs, columns=meta)).encode('utf-8')
+    data_start = _align(len(_MAGIC) + 8 + len(header))
+    with open(out_file, 'wb') as f:
+        f.write(_MAGIC)
+        f.write(struct.pack('<II', _VERSION, len(header)))
+        f.write(header)
+        for name, arr in columns.items():
+            f.seek(data_start + meta[name]['offset'])
+            f.write(arr.tobytes())
+        f.truncate(data_start + offset)
+
+
+def dump_binary_annotations(img_infos, out_file):
+    """Convert annotations of :class:`CustomDataset` format to binary.
+
+    Args:
+        img_infos (list[dict]): Annotations as described in
+            :class:`CustomDataset`.
+        out_file (str): Output filename.
+    """
+    names = [info['filename'].encode('utf-8') for info in img_infos]
+    name_offsets = np.zeros(len(names) + 1, dtype=np.int64)
+    name_offsets[1:] = np.cumsum([len(name) for name in names])
+    columns = dict(
+        filenames=np.frombuffer(b''.join(names), dtype=np.uint8),
+        filename_offsets=name_offsets,
+        width=np.array([info['width'] for info in img_infos], np.int32),
+        height=np.array([info['height'] for info in img_infos], np.int32))
+
+    anns = [info['ann'] for info in img_infos if 'ann' in info]
+    if anns:
+        if len(anns) != len(img_infos):
+            raise ValueError('either all or none of the images should have '
+                             'the "ann" field')
+        for ann in anns:
+            unsupported = set(ann.keys()) - {
+                'bboxes', 'labels', 'bboxes_ignore', 'labels_ignore'
+            }
+            if unsupported:
+                raise ValueError('unsupported annotation fields: {}'.format(
+                    ', '.join(sorted(unsupported))))
+        columns['bboxes'], columns['bbox_offsets'] = _concat(
+            [ann['bboxes'] for ann in anns], np.float32, 4)
+        columns['labels'], _ = _concat([ann['labels'] for ann in anns],
+                                       np.int64)
+        # optional fields are stored for all images or none of them
+        for key in ('bboxes_ignore', 'labels_ignore'):
+            num = sum(key in ann for ann in anns)
+            if 0 < num < len(anns):
+                raise ValueError('either all or none of the annotations '
+                                 'should have the "{}" field'.format(key))
+        if 'bboxes_ignore' in anns[0]:
+            columns['bboxes_ignore'], columns['ignore_offsets'] = _concat(
+                [ann['bboxes_ignore'] for ann in anns], np.float32, 4)
+        if 'labels_ignore' in anns[0]:
+            if 'bboxes_ignore' not in anns[0]:
+                raise ValueError('"labels_ignore" requires "bboxes_ignore"')
+            columns['labels_ignore'], _ = _concat(
+                [ann['labels_ignore'] for ann in anns], np.int64)
+    _write(out_file, 'annotations', len(img_infos), columns)
+
+
+def dump_binary_proposals(proposals, out_file):
+    """Convert a list of per-image proposals to binary.
+
+    Args:
+        proposals (list[ndarray]): Proposals of each image, each of shape
+            (n, 4) or (n, 5).
+        out_file (str): Output filename.
+    """
+    widths = set(p.shape[1] for p in proposals if len(p) > 0)
+    if len(widths) > 1:
+        raise ValueError('proposals should have the same number of columns')
+    width = widths.pop() if widths else 4
+    columns = dict()
+    columns['proposals'], columns['proposal_offsets'] = _concat(
+        proposals, np.float32, width)
+    _write(out_file, 'proposals', len(proposals), columns)
+
+
+class _BinaryFile(Sequence):
+    """Memory-mapped reader of files written by ``dump_binary_*``.
+
+    Every column is a read-only ``np.memmap``, so the per-image arrays handed
+    out are views into the page cache and are shared by all dataloader
+    workers instead of being unpickled into each of them.
+
+    Indexing with a list or an array of indices returns a new reader over the
+    selected images without copying any data.
+    """
+
+    kind = None
+
+    def __init__(self, filename, inds=None):
+        self.filename = filename
+        self._open()
+        self._inds = None if inds is None else np.asarray(inds, np.int64)
+
+    def _open(self):
+        with open(self.filename, 'rb') as f:
+            magic = f.read(len(_MAGIC))
+            if magic != _MAGIC:
+                raise ValueError('{} is not a binary annotation file'.format(
+                    self.filename))
+            version, header_size = struct.unpack('<II', f.read(8))
+            if version != _VERSION:
+                raise ValueError('unsupported binary format version {}'.format(
+                    version))
+            header = json.loads(f.read(header_size).decode('utf-8'))
+        if header['kind'] != self.kind:
+            raise ValueError('{} contains {}, but {} are expected'.format(
+                self.filename, header['kind'], self.kind))
+        data_start = _align(len(_MAGIC) + 8 + header_size)
+        self._num_imgs = header['num_imgs']
+        self._columns = {}
+        for name, meta in header['columns'].items():
+            shape = tuple(meta['shape'])
+            if np.prod(shape) == 0:
+                # zero-length mappings are not allowed
+                self._columns[name] = np.zeros(shape, dtype=meta['dtype'])
+            else:
+                self._columns[name] = np.memmap(
+                    self.filename,
+                    dtype=meta['dtype'],
+                    mode='r',
+                    offset=data_start + meta['offset'],
+                    shape=shape)
+
+    def __getstate__(self):
+        return dict(filename=self.filename, inds=self._inds)
+
+    def __setstate__(self, state):
+        self.__init__(state['filename'], state['inds'])
+
+    def __len__(self):
+        return self._num_imgs if self._inds is None else len(self._inds)
+
+    def _slice(self, name, offset_name, idx):
+        offsets = self._columns[offset_name]
+        return self._columns[name][offsets[idx]:offsets[idx + 1]]
+
+    def __getitem__(self, idx):
+        if isinstance(idx, (list, tuple, np.ndarray)):
+            inds = np.asarray(idx, dtype=np.int64)
+            if self._inds is not None:
+                inds = self._inds[inds]
+            return self.__class__(self.filename, inds)
+        if idx < 0:
+            idx += len(self)
+        if idx < 0 or idx >= len(self):
+            raise IndexError('index {} out of range'.format(idx))
+        if self._inds is not None:
+            idx = int(self._inds[idx])
+        return self._get(idx)
+
+    def _get(self, idx):
+        raise NotImplementedError
+
+
+class BinaryAnnotations(_BinaryFile):
+    """Annotations of :class:`CustomDataset` format backed by a binary file.
+
+    Items are dicts with the same fields as the pickle/json format, all
+    arrays are read-only views into the mapped file.
+    """
+
+    kind = 'annotations'
+
+    def _get(self, idx):
+        columns = self._columns
+        name = self._slice('filenames', 'filename_offsets', idx)
+        img_info = dict(
+            filename=name.tobytes().decode('utf-8'),
+            width=int(columns['width'][idx]),
+            height=int(columns['height'][idx]))
+        if 'bboxes' in columns:
+            ann = dict(
+                bboxes=self._slice('bboxes', 'bbox_offsets', idx),
+                labels=self._slice('labels', 'bbox_offsets', idx))
+            if 'bboxes_ignore' in columns:
+                ann['bboxes_ignore'] = self._slice('bboxes_ignore',
+                                                   'ignore_offsets', idx)
+            if 'labels_ignore' in columns:
+                ann['labels_ignore'] = self._slice('labels_ignore',
+                                                   'ignore_offsets', idx)
+            img_info['ann'] = ann
+        return img_info
+
+
+class BinaryProposals(_BinaryFile):
+    """Per-image proposals backed by a binary file."""
+
+    kind = 'proposals'
+
+    def _get(self, idx):
+        return self._slice('proposals', 'proposal_offsets', idx)
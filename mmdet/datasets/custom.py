@@ -9,6 +9,7 @@ from .transforms import (ImageTransform, BboxTransform, MaskTransform,
                          Numpy2Tensor)
 from .utils import to_tensor, random_scale
 from .extra_aug import ExtraAugmentation
+from .binary_ann import BinaryAnnotations, BinaryProposals
 
 
 class CustomDataset(Dataset):
@@ -31,6 +32,10 @@ class CustomDataset(Dataset):
     ]
 
     The `ann` field is optional for testing.
+
+    Annotation and proposal files with the ".bin" extension (converted by
+    `tools/convert_datasets/to_binary.py`) are memory-mapped instead of
+    being loaded, so that all dataloader workers share a single copy.
     """
 
     CLASSES = None
@@ -62,9 +67,9 @@ class CustomDataset(Dataset):
         # filter images with no annotation during training
         if not test_mode:
             valid_inds = self._filter_imgs()
-            self.img_infos = [self.img_infos[i] for i in valid_inds]
+            self.img_infos = self._subset(self.img_infos, valid_inds)
             if self.proposals is not None:
-                self.proposals = [self.proposals[i] for i in valid_inds]
+                self.proposals = self._subset(self.proposals, valid_inds)
 
         # (long_edge, short_edge) or [(long1, short1), (long2, short2), ...]
         self.img_scales = img_scale if isinstance(img_scale,
@@ -115,11 +120,22 @@ class CustomDataset(Dataset):
         return len(self.img_infos)
 
     def load_annotations(self, ann_file):
+        if ann_file.endswith('.bin'):
+            return BinaryAnnotations(ann_file)
         return mmcv.load(ann_file)
 
     def load_proposals(self, proposal_file):
+        if proposal_file.endswith('.bin'):
+            return BinaryProposals(proposal_file)
         return mmcv.load(proposal_file)
 
+    @staticmethod
+    def _subset(infos, inds):
+        if isinstance(infos, (BinaryAnnotations, BinaryProposals)):
+            # keep the memory-mapped data, only record the indices
+            return infos[inds]
+        return [infos[i] for i in inds]
+
     def get_ann_info(self, idx):
         return self.img_infos[idx]['ann']
 
@@ -189,9 +205,10 @@ class CustomDataset(Dataset):
         if len(gt_bboxes) == 0:
             return None
 
-        # extra augmentation
+        # extra augmentation (may modify boxes in place, so pass a copy to
+        # keep the cached or memory-mapped annotations untouched)
         if self.extra_aug is not None:
-            img, gt_bboxes, gt_labels = self.extra_aug(img, gt_bboxes,
+            img, gt_bboxes, gt_labels = self.extra_aug(img, gt_bboxes.copy(),
                                                        gt_labels)
 
         # apply transforms
@@ -2,6 +2,11 @@ import mmcv
 import numpy as np
 import torch
 
+try:
+    from mmdet.ops.img_transform import imnormalize_pad
+except ImportError:
+    imnormalize_pad = None
+
 __all__ = ['ImageTransform', 'BboxTransform', 'MaskTransform', 'Numpy2Tensor']
 
 
@@ -13,17 +18,22 @@ class ImageTransform(object):
     3. flip the image (if needed)
     4. pad the image (if needed)
     5. transpose to (c, h, w)
+
+    Steps 2-5 of uint8 BGR images are fused into a single native pass when
+    the img_transform op is compiled and `native` is True.
     """
 
     def __init__(self,
                  mean=(0, 0, 0),
                  std=(1, 1, 1),
                  to_rgb=True,
-                 size_divisor=None):
+                 size_divisor=None,
+                 native=True):
         self.mean = np.array(mean, dtype=np.float32)
         self.std = np.array(std, dtype=np.float32)
         self.to_rgb = to_rgb
         self.size_divisor = size_divisor
+        self.native = native and imnormalize_pad is not None
 
     def __call__(self, img, scale, flip=False, keep_ratio=True):
         if keep_ratio:
@@ -34,6 +44,12 @@ class ImageTransform(object):
             scale_factor = np.array([w_scale, h_scale, w_scale, h_scale],
                                     dtype=np.float32)
         img_shape = img.shape
+        if (self.native and img.dtype == np.uint8 and img.ndim == 3
+                and img.shape[2] == 3):
+            img, pad_shape = imnormalize_pad(img, self.mean, self.std,
+                                             self.to_rgb, flip,
+                                             self.size_divisor)
+            return img, img_shape, pad_shape, scale_factor
         img = mmcv.imnormalize(img, self.mean, self.std, self.to_rgb)
         if flip:
             img = mmcv.imflip(img)
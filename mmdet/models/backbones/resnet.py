@@ -159,7 +159,8 @@ class Bottleneck(nn.Module):
                 padding=dilation,
                 dilation=dilation,
                 deformable_groups=deformable_groups,
-                bias=False)
+                bias=False,
+                deterministic=dcn.get('deterministic', False))
         self.add_module(self.norm2_name, norm2)
         self.conv3 = nn.Conv2d(
             planes, planes * self.expansion, kernel_size=1, bias=False)
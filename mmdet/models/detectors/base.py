@@ -6,7 +6,7 @@ import numpy as np
 import torch.nn as nn
 import pycocotools.mask as maskUtils
 
-from mmdet.core import tensor2imgs, get_classes
+from mmdet.core import Deferred, bbox2result, tensor2imgs, get_classes
 
 
 class BaseDetector(nn.Module):
@@ -16,6 +16,19 @@ class BaseDetector(nn.Module):
 
     def __init__(self):
         super(BaseDetector, self).__init__()
+        # the test results may leave host side post-processing to Deferred
+        # parts, which are resolved later (see mmdet.apis.pipelined_test)
+        self.defer_postprocess = False
+
+    def bbox2result(self, det_bboxes, det_labels, num_classes):
+        """:func:`mmdet.core.bbox2result`, or a :class:`Deferred` one if the
+        post-processing is deferred."""
+        if self.defer_postprocess:
+            # copy the detections to the host now and split them by class
+            # later
+            return Deferred(bbox2result, det_bboxes.cpu(), det_labels.cpu(),
+                            num_classes)
+        return bbox2result(det_bboxes, det_labels, num_classes)
 
     @property
     def with_neck(self):
@@ -7,7 +7,7 @@ from .base import BaseDetector
 from .test_mixins import RPNTestMixin
 from .. import builder
 from ..registry import DETECTORS
-from mmdet.core import (assign_and_sample, bbox2roi, bbox2result, multi_apply,
+from mmdet.core import (assign_and_sample, bbox2roi, multi_apply,
                         merge_aug_masks)
 
 
@@ -221,8 +221,8 @@ class CascadeRCNN(BaseDetector, RPNTestMixin):
                     scale_factor,
                     rescale=rescale,
                     cfg=rcnn_test_cfg)
-                bbox_result = bbox2result(det_bboxes, det_labels,
-                                          bbox_head.num_classes)
+                bbox_result = self.bbox2result(det_bboxes, det_labels,
+                                               bbox_head.num_classes)
                 ms_bbox_result['stage{}'.format(i)] = bbox_result
 
                 if self.with_mask:
@@ -259,8 +259,8 @@ class CascadeRCNN(BaseDetector, RPNTestMixin):
             scale_factor,
             rescale=rescale,
             cfg=rcnn_test_cfg)
-        bbox_result = bbox2result(det_bboxes, det_labels,
-                                  self.bbox_head[-1].num_classes)
+        bbox_result = self.bbox2result(det_bboxes, det_labels,
+                                       self.bbox_head[-1].num_classes)
         ms_bbox_result['ensemble'] = bbox_result
 
         if self.with_mask:
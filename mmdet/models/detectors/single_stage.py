@@ -3,7 +3,6 @@ import torch.nn as nn
 from .base import BaseDetector
 from .. import builder
 from ..registry import DETECTORS
-from mmdet.core import bbox2result
 
 
 @DETECTORS.register_module
@@ -55,7 +54,8 @@ class SingleStageDetector(BaseDetector):
         bbox_inputs = outs + (img_meta, self.test_cfg, rescale)
         bbox_list = self.bbox_head.get_bboxes(*bbox_inputs)
         bbox_results = [
-            bbox2result(det_bboxes, det_labels, self.bbox_head.num_classes)
+            self.bbox2result(det_bboxes, det_labels,
+                             self.bbox_head.num_classes)
             for det_bboxes, det_labels in bbox_list
         ]
         return bbox_results[0]
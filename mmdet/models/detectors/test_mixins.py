@@ -1,5 +1,5 @@
-from mmdet.core import (bbox2roi, bbox_mapping, merge_aug_proposals,
-                        merge_aug_bboxes, merge_aug_masks, multiclass_nms)
+from mmdet.core import (Deferred, bbox2roi, bbox_mapping, merge_aug_proposals,
+                        merge_aug_dets, merge_aug_masks)
 
 
 class RPNTestMixin(object):
@@ -77,11 +77,8 @@ class BBoxTestMixin(object):
             aug_bboxes.append(bboxes)
             aug_scores.append(scores)
         # after merging, bboxes will be rescaled to the original image size
-        merged_bboxes, merged_scores = merge_aug_bboxes(
-            aug_bboxes, aug_scores, img_metas, rcnn_test_cfg)
-        det_bboxes, det_labels = multiclass_nms(
-            merged_bboxes, merged_scores, rcnn_test_cfg.score_thr,
-            rcnn_test_cfg.nms, rcnn_test_cfg.max_per_img)
+        det_bboxes, det_labels = merge_aug_dets(aug_bboxes, aug_scores,
+                                                img_metas, rcnn_test_cfg)
         return det_bboxes, det_labels
 
 
@@ -107,9 +104,18 @@ class MaskTestMixin(object):
             mask_feats = self.mask_roi_extractor(
                 x[:len(self.mask_roi_extractor.featmap_strides)], mask_rois)
             mask_pred = self.mask_head(mask_feats)
-            segm_result = self.mask_head.get_seg_masks(
-                mask_pred, _bboxes, det_labels, self.test_cfg.rcnn, ori_shape,
-                scale_factor, rescale)
+            if self.defer_postprocess:
+                # copy the predictions to the host now and resize and encode
+                # the masks later
+                segm_result = Deferred(
+                    self.mask_head.get_seg_masks,
+                    mask_pred.sigmoid().cpu().numpy(), _bboxes.cpu(),
+                    det_labels.cpu(), self.test_cfg.rcnn, ori_shape,
+                    scale_factor, rescale)
+            else:
+                segm_result = self.mask_head.get_seg_masks(
+                    mask_pred, _bboxes, det_labels, self.test_cfg.rcnn,
+                    ori_shape, scale_factor, rescale)
         return segm_result
 
     def aug_test_mask(self, feats, img_metas, det_bboxes, det_labels):
@@ -5,7 +5,7 @@ from .base import BaseDetector
 from .test_mixins import RPNTestMixin, BBoxTestMixin, MaskTestMixin
 from .. import builder
 from ..registry import DETECTORS
-from mmdet.core import bbox2roi, bbox2result, build_assigner, build_sampler
+from mmdet.core import bbox2roi, build_assigner, build_sampler
 
 
 @DETECTORS.register_module
@@ -163,8 +163,8 @@ class TwoStageDetector(BaseDetector, RPNTestMixin, BBoxTestMixin,
 
         det_bboxes, det_labels = self.simple_test_bboxes(
             x, img_meta, proposal_list, self.test_cfg.rcnn, rescale=rescale)
-        bbox_results = bbox2result(det_bboxes, det_labels,
-                                   self.bbox_head.num_classes)
+        bbox_results = self.bbox2result(det_bboxes, det_labels,
+                                        self.bbox_head.num_classes)
 
         if not self.with_mask:
             return bbox_results
@@ -191,8 +191,8 @@ class TwoStageDetector(BaseDetector, RPNTestMixin, BBoxTestMixin,
         else:
             _det_bboxes = det_bboxes.clone()
             _det_bboxes[:, :4] *= img_metas[0][0]['scale_factor']
-        bbox_results = bbox2result(_det_bboxes, det_labels,
-                                   self.bbox_head.num_classes)
+        bbox_results = self.bbox2result(_det_bboxes, det_labels,
+                                        self.bbox_head.num_classes)
 
         # det_bboxes always keep the original scale
         if self.with_mask:
@@ -3,7 +3,8 @@ from .dcn import (DeformConv, DeformRoIPooling, DeformRoIPoolingPack,
                   ModulatedDeformConvPack, deform_conv, modulated_deform_conv,
                   deform_roi_pooling)
 from .nms import nms, soft_nms
-from .roi_align import RoIAlign, roi_align
+from .roi_align import (QuantizedRoIAlign, RoIAlign, roi_align,
+                        roi_align_quantized)
 from .roi_pool import RoIPool, roi_pool
 
 __all__ = [
@@ -11,5 +12,5 @@ __all__ = [
     'DeformConv', 'DeformRoIPooling', 'DeformRoIPoolingPack',
     'ModulatedDeformRoIPoolingPack', 'ModulatedDeformConv',
     'ModulatedDeformConvPack', 'deform_conv', 'modulated_deform_conv',
-    'deform_roi_pooling'
+    'deform_roi_pooling', 'QuantizedRoIAlign', 'roi_align_quantized'
 ]
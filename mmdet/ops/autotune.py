@@ -0,0 +1,220 @@
+import atexit
+import json
+import os
+import os.path as osp
+import tempfile
+import threading
+import time
+
+import torch
+
+DEFAULT_CACHE_FILE = osp.join(
+    osp.expanduser('~'), '.cache', 'mmdet', 'autotune.json')
+
+# candidate launch configurations, the first one is the default that is used
+# until a configuration has been tuned for a shape
+CUDA_THREADS = (1024, 512, 256, 128)
+# channels of a work item of the CPU RoI kernels
+CPU_CHANNELS_PER_ITEM = (16, 4, 8, 32, 64)
+
+
+_device_names = {}
+
+
+def cuda_device_name(index):
+    """Name of a GPU, cached per device index since querying it is slow."""
+    if index not in _device_names:
+        _device_names[index] = torch.cuda.get_device_name(index)
+    return _device_names[index]
+
+
+def shape_bucket(shape):
+    """Round every dim up to a power of 2 so that close shapes share a tuned
+    configuration."""
+    return tuple(1 << max(int(s) - 1, 0).bit_length() for s in shape)
+
+
+def im2col_steps(batch_size, max_step=64):
+    """``im2col_step`` candidates for a batch, the default one first."""
+    default = min(max_step, batch_size)
+    steps = [default]
+    step = 1
+    while step < default:
+        if batch_size % step == 0:
+            steps.append(step)
+        step *= 2
+    return steps
+
+
+class KernelAutotuner(object):
+    """Shape keyed autotuner for the launch parameters of the ops.
+
+    The first time an (op, dtype, shape bucket) is seen with tuning enabled,
+    every candidate configuration is timed and the fastest one is kept. Tuned
+    configurations are stored in a json file and reused by later runs, which
+    use the cached configuration (or the default one) without tuning when
+    tuning is disabled. New configurations are saved when the process exits
+    (or by :meth:`save`), not in the middle of a forward pass.
+
+    Args:
+        cache_file (str): Json file of the tuned configurations. Defaults to
+            ``$MMDET_AUTOTUNE_CACHE`` or ``~/.cache/mmdet/autotune.json``.
+        enabled (bool): Whether to tune unseen keys. Defaults to
+            ``$MMDET_AUTOTUNE == '1'``.
+        warmup (int): Untimed runs of each candidate.
+        repeat (int): Timed runs of each candidate, the median is used.
+    """
+
+    def __init__(self, cache_file=None, enabled=None, warmup=1, repeat=5):
+        if cache_file is None:
+            cache_file = os.environ.get('MMDET_AUTOTUNE_CACHE',
+                                        DEFAULT_CACHE_FILE)
+        if enabled is None:
+            enabled = os.environ.get('MMDET_AUTOTUNE', '0') == '1'
+        self.cache_file = cache_file
+        self.enabled = enabled
+        self.warmup = warmup
+        self.repeat = repeat
+        self._cache = None
+        self._dirty = False
+        # guards the cache, which threads sharing a model read and update
+        self._lock = threading.RLock()
+        atexit.register(self.flush)
+
+    @property
+    def active(self):
+        """Whether there is anything to tune or look up. When there is not,
+        the default configurations are used without building keys."""
+        return self.enabled or bool(self.cache)
+
+    def make_key(self, tensor, *shapes, **kwargs):
+        """Key of the device and dtype of a tensor, the shape buckets of some
+        sizes and exact parameters (e.g. pooled size) of the op.
+
+        Returns None if the autotuner is not :attr:`active`, which selects
+        the default configuration.
+        """
+        if not self.active:
+            return None
+        if tensor.is_cuda:
+            device = cuda_device_name(tensor.get_device())
+        else:
+            # the best cpu partitioning depends on the number of threads
+            device = 'cpu{}'.format(torch.get_num_threads())
+        parts = [device, str(tensor.dtype).replace('torch.', '')]
+        parts += ['x'.join(str(s) for s in shape_bucket(shape))
+                  for shape in shapes]
+        parts += ['{}={}'.format(k, kwargs[k]) for k in sorted(kwargs)]
+        return '|'.join(parts)
+
+    @property
+    def cache(self):
+        if self._cache is None:
+            with self._lock:
+                if self._cache is None:
+                    self._cache = self._read()
+        return self._cache
+
+    def _read(self):
+        if not osp.isfile(self.cache_file):
+            return {}
+        try:
+            with open(self.cache_file, 'r') as f:
+                return json.load(f)
+        except (IOError, ValueError):
+            # a corrupted cache only costs a retune
+            return {}
+
+    def save(self):
+        """Merge the tuned configurations into the cache file.
+
+        Entries written by other processes meanwhile are kept and the file is
+        replaced atomically, so concurrent workers do not corrupt it.
+        """
+        with self._lock:
+            merged = self._read()
+            for op, entries in self.cache.items():
+                merged.setdefault(op, {}).update(entries)
+            dirname = osp.dirname(osp.abspath(self.cache_file))
+            if not osp.isdir(dirname):
+                os.makedirs(dirname)
+            fd, tmp_file = tempfile.mkstemp(dir=dirname, suffix='.tmp')
+            with os.fdopen(fd, 'w') as f:
+                json.dump(merged, f, indent=2, sort_keys=True)
+            os.rename(tmp_file, self.cache_file)
+            self._cache = merged
+            self._dirty = False
+
+    def flush(self):
+        """Save the cache if configurations were tuned since the last save."""
+        if self._dirty:
+            self.save()
+
+    def lookup(self, op, key):
+        return self.cache.get(op, {}).get(key)
+
+    def select(self, op, key, candidates, run, sync_cuda=False):
+        """Return the configuration to use for (op, key).
+
+        Args:
+            op (str): Name of the op (and pass, e.g. "roi_align_forward").
+            key (str | None): See :meth:`make_key`, None selects the default
+                configuration.
+            candidates (list[dict]): Configurations to choose from, the first
+                one is the default.
+            run (callable): ``run(config)`` runs the op once with a config,
+                it must not have side effects on the real outputs.
+            sync_cuda (bool): Synchronize cuda around the timed runs.
+
+        Returns:
+            dict: The selected configuration.
+        """
+        if key is None:
+            return candidates[0]
+        config = self.lookup(op, key)
+        if config is not None and config in candidates:
+            return config
+        if not self.enabled or len(candidates) == 1:
+            return candidates[0]
+
+        best_time, config = None, candidates[0]
+        for candidate in candidates:
+            elapsed = self._measure(run, candidate, sync_cuda)
+            if elapsed is not None and (best_time is None
+                                        or elapsed < best_time):
+                best_time, config = elapsed, candidate
+        with self._lock:
+            self.cache.setdefault(op, {})[key] = config
+            self._dirty = True
+        return config
+
+    def run(self, op, key, name, values, fn, sync_cuda=False):
+        """Call ``fn(value)`` with the tuned value of a single parameter.
+
+        ``fn`` is called once per timed run while tuning, so it must give the
+        same result when called repeatedly.
+        """
+        config = self.select(op, key, [{name: v} for v in values],
+                             lambda c: fn(c[name]), sync_cuda)
+        return fn(config[name])
+
+    def _measure(self, run, config, sync_cuda):
+        try:
+            for _ in range(self.warmup):
+                run(config)
+            times = []
+            for _ in range(self.repeat):
+                if sync_cuda:
+                    torch.cuda.synchronize()
+                start = time.time()
+                run(config)
+                if sync_cuda:
+                    torch.cuda.synchronize()
+                times.append(time.time() - start)
+        except RuntimeError:
+            # e.g. too many resources requested for launch
+            return None
+        return sorted(times)[len(times) // 2]
+
+
+autotuner = KernelAutotuner()
@@ -0,0 +1,111 @@
+// Helpers shared by the CPU implementations of the ops. Every setup.py adds
+// this directory to the include path.
+#ifndef MMDET_OPS_CPU_UTILS_H
+#define MMDET_OPS_CPU_UTILS_H
+
+#include <ATen/ATen.h>
+
+#include <omp.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+// Inputs may be stored in fp16 to halve the memory traffic of the gathers,
+// they are interpolated, compared and accumulated in fp32 (acc_t).
+template <typename scalar_t>
+struct acc_type {
+  typedef scalar_t type;
+};
+
+template <>
+struct acc_type<at::Half> {
+  typedef float type;
+};
+
+// Accumulates into a run of stored values: in place when they already have
+// the accumulation type, through a zeroed acc_t buffer that is added back
+// once at the end otherwise.
+template <typename scalar_t, typename acc_t>
+struct Accumulator {
+  std::vector<acc_t> buffer;
+  scalar_t *data;
+
+  acc_t *begin(scalar_t *ptr, const int64_t size) {
+    data = ptr;
+    buffer.assign(size, acc_t(0));
+    return buffer.data();
+  }
+
+  void end() {
+    for (size_t i = 0; i < buffer.size(); ++i) {
+      data[i] = static_cast<scalar_t>(static_cast<acc_t>(data[i]) + buffer[i]);
+    }
+  }
+};
+
+template <typename scalar_t>
+struct Accumulator<scalar_t, scalar_t> {
+  scalar_t *begin(scalar_t *ptr, const int64_t size) { return ptr; }
+  void end() {}
+};
+
+// Dtypes of the RoI ops: the output (and thus its gradient) has either the
+// dtype of the features or the accumulation dtype, rois always have the
+// accumulation dtype.
+inline void check_types(const at::Tensor features, const at::Tensor rois,
+                        const at::Tensor output) {
+  const at::ScalarType type = features.type().scalarType();
+  const at::ScalarType acc = type == at::kHalf ? at::kFloat : type;
+  AT_CHECK(rois.type().scalarType() == acc,
+           "rois must have the accumulation dtype of the features");
+  AT_CHECK(output.type().scalarType() == type ||
+               output.type().scalarType() == acc,
+           "output must have the dtype or the accumulation dtype of the "
+           "features");
+}
+
+// Runs fn(item) for every item on all OpenMP threads. Items are handed out
+// from a shared counter in order of decreasing cost, so that the expensive
+// ones start first and the cheap ones fill the gaps at the end. With uneven
+// items (rois of very different areas, classes with very different numbers
+// of candidates) a static partition would leave most threads idle behind the
+// threads that got the few large items.
+//
+// Costs are only compared by their power of two, and items of the same
+// bucket keep their input order. This is enough for the load balance, and
+// keeps the locality of inputs sorted by position (e.g. rois sorted with
+// reorder=True) within a bucket.
+inline int cost_bucket(int64_t cost) {
+  int bucket = 0;
+  while (cost > 1) {
+    cost >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+template <typename Fn>
+void parallel_for_cost(const std::vector<int64_t> &cost, const Fn &fn) {
+  const int64_t num_items = cost.size();
+  std::vector<int> bucket(num_items);
+  for (int64_t i = 0; i < num_items; i++) bucket[i] = cost_bucket(cost[i]);
+  std::vector<int64_t> order(num_items);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int64_t a, int64_t b) {
+    return bucket[a] > bucket[b];
+  });
+  std::atomic<int64_t> next(0);
+  const int num_threads = static_cast<int>(std::min<int64_t>(
+      omp_get_max_threads(), std::max<int64_t>(num_items, 1)));
+#pragma omp parallel num_threads(num_threads)
+  {
+    int64_t i;
+    while ((i = next.fetch_add(1, std::memory_order_relaxed)) < num_items) {
+      fn(order[i]);
+    }
+  }
+}
+
+#endif  // MMDET_OPS_CPU_UTILS_H
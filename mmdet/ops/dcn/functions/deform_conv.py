@@ -2,7 +2,29 @@ import torch
 from torch.autograd import Function
 from torch.nn.modules.utils import _pair
 
-from .. import deform_conv_cuda
+from .. import deform_conv_cpu, deform_conv_cuda
+from mmdet.ops.autotune import CUDA_THREADS, autotuner, im2col_steps
+
+
+def _ext(tensor):
+    """The extension driving the CPU or CUDA kernels, which share the same
+    host code and functions."""
+    return deform_conv_cuda if tensor.is_cuda else deform_conv_cpu
+
+
+def _tuned_config(op, input, weight, offset, params, im2col_step, run):
+    """Tuned ``im2col_step`` and CUDA threads per block of a deformable
+    convolution, ``run(config)`` runs the forward pass with a config."""
+    key = autotuner.make_key(input, input.shape, weight.shape, offset.shape,
+                             **params)
+    steps = [None] if im2col_step is None else im2col_steps(
+        input.size(0), im2col_step)
+    # the CPU kernels have no launch parameters
+    threads = CUDA_THREADS if input.is_cuda else CUDA_THREADS[:1]
+    candidates = [
+        dict(im2col_step=step, threads=t) for step in steps for t in threads
+    ]
+    return autotuner.select(op, key, candidates, run, input.is_cuda)
 
 
 class DeformConvFunction(Function):
@@ -16,7 +38,9 @@ class DeformConvFunction(Function):
                 padding=0,
                 dilation=1,
                 deformable_groups=1,
-                im2col_step=64):
+                im2col_step=64,
+                deterministic=False,
+                out_dtype=None):
         if input is not None and input.dim() != 4:
             raise ValueError(
                 "Expected 4D tensor as input, got {}D tensor instead.".format(
@@ -26,26 +50,39 @@ class DeformConvFunction(Function):
         ctx.dilation = _pair(dilation)
         ctx.deformable_groups = deformable_groups
         ctx.im2col_step = im2col_step
+        ctx.deterministic = deterministic
 
         ctx.save_for_backward(input, offset, weight)
 
+        # fp16 CPU inputs are sampled and accumulated in fp32 and may be
+        # written as fp32 (the weights must be fp32 for them)
         output = input.new_empty(
             DeformConvFunction._output_size(input, weight, ctx.padding,
-                                            ctx.dilation, ctx.stride))
+                                            ctx.dilation, ctx.stride),
+            dtype=out_dtype or input.dtype)
 
         ctx.bufs_ = [input.new_empty(0), input.new_empty(0)]  # columns, ones
 
-        if not input.is_cuda:
-            raise NotImplementedError
-        else:
-            cur_im2col_step = min(ctx.im2col_step, input.shape[0])
-            assert (input.shape[0] %
-                    cur_im2col_step) == 0, 'im2col step must divide batchsize'
-            deform_conv_cuda.deform_conv_forward_cuda(
+        assert (input.shape[0] % min(ctx.im2col_step, input.shape[0])
+                ) == 0, 'im2col step must divide batchsize'
+
+        def run(config):
+            _ext(input).deform_conv_forward_cuda(
                 input, weight, offset, output, ctx.bufs_[0], ctx.bufs_[1],
                 weight.size(3), weight.size(2), ctx.stride[1], ctx.stride[0],
                 ctx.padding[1], ctx.padding[0], ctx.dilation[1],
-                ctx.dilation[0], ctx.deformable_groups, cur_im2col_step)
+                ctx.dilation[0], ctx.deformable_groups, config['im2col_step'],
+                config['threads'])
+
+        params = dict(
+            stride=ctx.stride,
+            padding=ctx.padding,
+            dilation=ctx.dilation,
+            groups=deformable_groups)
+        # the backward pass reuses the configuration of the forward pass
+        ctx.config = _tuned_config('deform_conv', input, weight, offset,
+                                   params, ctx.im2col_step, run)
+        run(ctx.config)
         return output
 
     @staticmethod
@@ -54,33 +91,31 @@ class DeformConvFunction(Function):
 
         grad_input = grad_offset = grad_weight = None
 
-        if not grad_output.is_cuda:
-            raise NotImplementedError
-        else:
-            cur_im2col_step = min(ctx.im2col_step, input.shape[0])
-            assert (input.shape[0] %
-                    cur_im2col_step) == 0, 'im2col step must divide batchsize'
-
-            if ctx.needs_input_grad[0] or ctx.needs_input_grad[1]:
-                grad_input = torch.zeros_like(input)
-                grad_offset = torch.zeros_like(offset)
-                deform_conv_cuda.deform_conv_backward_input_cuda(
-                    input, offset, grad_output, grad_input,
-                    grad_offset, weight, ctx.bufs_[0], weight.size(3),
-                    weight.size(2), ctx.stride[1], ctx.stride[0],
-                    ctx.padding[1], ctx.padding[0], ctx.dilation[1],
-                    ctx.dilation[0], ctx.deformable_groups, cur_im2col_step)
-
-            if ctx.needs_input_grad[2]:
-                grad_weight = torch.zeros_like(weight)
-                deform_conv_cuda.deform_conv_backward_parameters_cuda(
-                    input, offset, grad_output,
-                    grad_weight, ctx.bufs_[0], ctx.bufs_[1], weight.size(3),
-                    weight.size(2), ctx.stride[1], ctx.stride[0],
-                    ctx.padding[1], ctx.padding[0], ctx.dilation[1],
-                    ctx.dilation[0], ctx.deformable_groups, 1, cur_im2col_step)
-
-        return grad_input, grad_offset, grad_weight, None, None, None, None
+        cur_im2col_step = ctx.config['im2col_step']
+        threads = ctx.config['threads']
+
+        if ctx.needs_input_grad[0] or ctx.needs_input_grad[1]:
+            grad_input = torch.zeros_like(input)
+            grad_offset = torch.zeros_like(offset)
+            _ext(input).deform_conv_backward_input_cuda(
+                input, offset, grad_output, grad_input,
+                grad_offset, weight, ctx.bufs_[0], weight.size(3),
+                weight.size(2), ctx.stride[1], ctx.stride[0], ctx.padding[1],
+                ctx.padding[0], ctx.dilation[1], ctx.dilation[0],
+                ctx.deformable_groups, cur_im2col_step, ctx.deterministic,
+                threads)
+
+        if ctx.needs_input_grad[2]:
+            grad_weight = torch.zeros_like(weight)
+            _ext(input).deform_conv_backward_parameters_cuda(
+                input, offset, grad_output,
+                grad_weight, ctx.bufs_[0], ctx.bufs_[1], weight.size(3),
+                weight.size(2), ctx.stride[1], ctx.stride[0], ctx.padding[1],
+                ctx.padding[0], ctx.dilation[1], ctx.dilation[0],
+                ctx.deformable_groups, 1, cur_im2col_step, threads)
+
+        return (grad_input, grad_offset, grad_weight, None, None, None, None,
+                None, None, None)
 
     @staticmethod
     def _output_size(input, weight, padding, dilation, stride):
@@ -111,50 +146,64 @@ class ModulatedDeformConvFunction(Function):
                 stride=1,
                 padding=0,
                 dilation=1,
-                deformable_groups=1):
+                deformable_groups=1,
+                deterministic=False,
+                out_dtype=None):
         ctx.stride = stride
         ctx.padding = padding
         ctx.dilation = dilation
         ctx.deformable_groups = deformable_groups
+        ctx.deterministic = deterministic
         ctx.with_bias = bias is not None
         if not ctx.with_bias:
             bias = input.new_empty(1)  # fake tensor
-        if not input.is_cuda:
-            raise NotImplementedError
         if weight.requires_grad or mask.requires_grad or offset.requires_grad \
                 or input.requires_grad:
             ctx.save_for_backward(input, offset, mask, weight, bias)
         output = input.new_empty(
-            ModulatedDeformConvFunction._infer_shape(ctx, input, weight))
+            ModulatedDeformConvFunction._infer_shape(ctx, input, weight),
+            dtype=out_dtype or input.dtype)
         ctx._bufs = [input.new_empty(0), input.new_empty(0)]
-        deform_conv_cuda.modulated_deform_conv_cuda_forward(
-            input, weight, bias, ctx._bufs[0], offset, mask, output,
-            ctx._bufs[1], weight.shape[2], weight.shape[3], ctx.stride,
-            ctx.stride, ctx.padding, ctx.padding, ctx.dilation, ctx.dilation,
-            ctx.deformable_groups, ctx.with_bias)
+
+        def run(config):
+            _ext(input).modulated_deform_conv_cuda_forward(
+                input, weight, bias, ctx._bufs[0], offset, mask, output,
+                ctx._bufs[1], weight.shape[2], weight.shape[3], ctx.stride,
+                ctx.stride, ctx.padding, ctx.padding, ctx.dilation,
+                ctx.dilation, ctx.deformable_groups, ctx.with_bias,
+                config['threads'])
+
+        params = dict(
+            stride=ctx.stride,
+            padding=ctx.padding,
+            dilation=ctx.dilation,
+            groups=deformable_groups)
+        # images are processed one by one, there is no im2col_step
+        ctx.config = _tuned_config('modulated_deform_conv', input, weight,
+                                   offset, params, None, run)
+        run(ctx.config)
         return output
 
     @staticmethod
     def backward(ctx, grad_output):
-        if not grad_output.is_cuda:
-            raise NotImplementedError
         input, offset, mask, weight, bias = ctx.saved_tensors
         grad_input = torch.zeros_like(input)
         grad_offset = torch.zeros_like(offset)
         grad_mask = torch.zeros_like(mask)
         grad_weight = torch.zeros_like(weight)
         grad_bias = torch.zeros_like(bias)
-        deform_conv_cuda.modulated_deform_conv_cuda_backward(
+        _ext(input).modulated_deform_conv_cuda_backward(
             input, weight, bias, ctx._bufs[0], offset, mask, ctx._bufs[1],
             grad_input, grad_weight, grad_bias, grad_offset, grad_mask,
             grad_output, weight.shape[2], weight.shape[3], ctx.stride,
             ctx.stride, ctx.padding, ctx.padding, ctx.dilation, ctx.dilation,
-            ctx.deformable_groups, ctx.with_bias)
+            ctx.deformable_groups, ctx.with_bias, ctx.deterministic,
+            ctx.config['threads'])
         if not ctx.with_bias:
             grad_bias = None
 
         return (grad_input, grad_offset, grad_mask, grad_weight, grad_bias,
-                None, None, None, None)
+                None, None, None, None, None, None)
 
     @staticmethod
     def _infer_shape(ctx, input, weight):
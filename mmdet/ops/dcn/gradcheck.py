@@ -0,0 +1,118 @@
+import torch
+from torch.autograd import gradcheck
+
+import os.path as osp
+import sys
+# the ops import each other relatively, import them from the repository
+sys.path.append(osp.abspath(osp.join(__file__, '../../../../')))
+from mmdet.ops.dcn import deform_conv, modulated_deform_conv  # noqa: E402
+
+input = torch.randn(2, 4, 6, 6)
+offset = torch.randn(2, 2 * 3 * 3, 6, 6) * 2
+weight = torch.randn(3, 4, 3, 3) / 6
+args = (1, 1, 1, 1, 2)  # stride, padding, dilation, groups, im2col_step
+
+
+def double_inputs(*tensors):
+    return [t.double().requires_grad_() for t in tensors]
+
+
+print('Gradcheck for deform conv (CPU)...')
+test = gradcheck(
+    lambda x, o, w: deform_conv(x, o, w, *args),
+    double_inputs(input, offset, weight),
+    eps=1e-6,
+    atol=1e-4)
+print(test)
+
+if torch.cuda.is_available():
+    print('Gradcheck for deform conv...')
+    test = gradcheck(
+        lambda x, o, w: deform_conv(x, o, w, *args),
+        [t.cuda() for t in double_inputs(input, offset, weight)],
+        eps=1e-6,
+        atol=1e-4)
+    print(test)
+
+
+def backward(device, dtype, deterministic, modulated):
+    """Gradients of the inputs of a deformable convolution."""
+    inputs = [
+        t.to(device=device, dtype=dtype).requires_grad_()
+        for t in (input, offset, mask, weight)
+    ]
+    x, o, m, w = inputs
+    if modulated:
+        out = modulated_deform_conv(x, o, m, w, None, 1, 1, 1, 1,
+                                    deterministic)
+    else:
+        out = deform_conv(x, o, w, *(args + (deterministic, )))
+        inputs = inputs[:2] + inputs[3:]
+    out.backward(grad_output.to(device=device, dtype=dtype))
+    return [t.grad for t in inputs]
+
+
+# the fused col2im of the CUDA backward, with float atomics and in
+# deterministic mode, against the CPU backward in fp64, and the bitwise
+# repeatability of the deterministic modes
+mask = torch.rand(2, 3 * 3, 6, 6)
+grad_output = torch.randn(2, 3, 6, 6)
+for modulated in (False, True):
+    name = 'modulated deform conv' if modulated else 'deform conv'
+    print('Backward modes of {}...'.format(name))
+    ref = backward('cpu', torch.double, False, modulated)
+    runs = [backward('cpu', torch.float, False, modulated) for _ in range(2)]
+    assert all(torch.equal(a, b) for a, b in zip(*runs)), 'cpu repeatability'
+    assert all(
+        torch.allclose(a.double(), b, atol=1e-4) for a, b in zip(runs[0], ref))
+    if torch.cuda.is_available():
+        for deterministic in (False, True):
+            runs = [
+                backward('cuda', torch.float, deterministic, modulated)
+                for _ in range(2)
+            ]
+            assert all(
+                torch.allclose(a.cpu().double(), b, atol=1e-4)
+                for a, b in zip(runs[0], ref)), 'cuda vs cpu'
+            if deterministic:
+                assert all(torch.equal(a, b)
+                           for a, b in zip(*runs)), 'cuda repeatability'
+    print('OK')
+
+
+def check_errors(name, output, ref, mean_rel, max_abs=None):
+    """Check the max absolute and mean relative error against an fp64
+    reference."""
+    diff = (output.double() - ref).abs()
+    max_err = diff.max().item()
+    mean_rel_err = (diff.sum() / ref.abs().sum()).item()
+    print('{}: max abs err {:.3g}, mean rel err {:.3g}'.format(
+        name, max_err, mean_rel_err))
+    assert mean_rel_err < mean_rel, name
+    assert max_abs is None or max_err < max_abs, name
+
+
+# fp16 storage on the CPU is sampled and accumulated in fp32, check the
+# errors of the reduced precision table in TECHNICAL_DETAILS.md (at most
+# twice the table values for fp16 storage)
+print('Errors of deform conv (CPU) against fp64...')
+big_input = torch.randn(1, 256, 50, 84, dtype=torch.double)
+big_offset = torch.randn(1, 2 * 3 * 3, 50, 84, dtype=torch.double) * 2
+big_weight = torch.randn(64, 256, 3, 3, dtype=torch.double) / 48
+grad = torch.randn(1, 64, 50, 84, dtype=torch.double)
+outputs = []
+for dtype in (torch.double, torch.float, torch.half):
+    x = big_input.to(dtype).requires_grad_()
+    o = big_offset.to(dtype).requires_grad_()
+    # the weights and the columns stay fp32 with fp16 storage
+    w = big_weight.to(torch.double if dtype == torch.double else torch.float)
+    out = deform_conv(x, o, w, 1, 1, 1, 1, 1, False, w.dtype)
+    out.backward(grad.to(w.dtype))
+    outputs.append((out, x.grad, o.grad))
+ref = outputs[0]
+for (name, mean_rel, max_abs), output, fp32_output, ref_output in zip(
+    [('output', 2e-3, 9e-3), ('grad input', 2e-3, 5.2e-3),
+     ('grad offset', 3e-3, None)], outputs[2], outputs[1], ref):
+    check_errors(name + ' fp32', fp32_output, ref_output, 1e-4)
+    check_errors(name + ' fp16 storage', output, ref_output, mean_rel,
+                 max_abs)
@@ -17,7 +17,9 @@ class DeformConv(nn.Module):
                  padding=0,
                  dilation=1,
                  deformable_groups=1,
-                 bias=False):
+                 bias=False,
+                 im2col_step=64,
+                 deterministic=False):
         assert not bias
         super(DeformConv, self).__init__()
         self.in_channels = in_channels
@@ -27,6 +29,8 @@ class DeformConv(nn.Module):
         self.padding = _pair(padding)
         self.dilation = _pair(dilation)
         self.deformable_groups = deformable_groups
+        self.im2col_step = im2col_step
+        self.deterministic = deterministic
 
         self.weight = nn.Parameter(
             torch.Tensor(out_channels, in_channels, *self.kernel_size))
@@ -42,7 +46,8 @@ class DeformConv(nn.Module):
 
     def forward(self, input, offset):
         return deform_conv(input, offset, self.weight, self.stride,
-                           self.padding, self.dilation, self.deformable_groups)
+                           self.padding, self.dilation, self.deformable_groups,
+                           self.im2col_step, self.deterministic)
 
 
 class ModulatedDeformConv(nn.Module):
@@ -55,7 +60,8 @@ class ModulatedDeformConv(nn.Module):
                  padding=0,
                  dilation=1,
                  deformable_groups=1,
-                 bias=True):
+                 bias=True,
+                 deterministic=False):
         super(ModulatedDeformConv, self).__init__()
         self.in_channels = in_channels
         self.out_channels = out_channels
@@ -65,6 +71,7 @@ class ModulatedDeformConv(nn.Module):
         self.dilation = dilation
         self.deformable_groups = deformable_groups
         self.with_bias = bias
+        self.deterministic = deterministic
 
         self.weight = nn.Parameter(
             torch.Tensor(out_channels, in_channels, *self.kernel_size))
@@ -84,9 +91,10 @@ class ModulatedDeformConv(nn.Module):
             self.bias.data.zero_()
 
     def forward(self, input, offset, mask):
-        return modulated_deform_conv(input, offset, mask, self.weight,
-                                     self.bias, self.stride, self.padding,
-                                     self.dilation, self.deformable_groups)
+        return modulated_deform_conv(
+            input, offset, mask, self.weight, self.bias, self.stride,
+            self.padding, self.dilation, self.deformable_groups,
+            self.deterministic)
 
 
 class ModulatedDeformConvPack(ModulatedDeformConv):
@@ -99,10 +107,11 @@ class ModulatedDeformConvPack(ModulatedDeformConv):
                  padding=0,
                  dilation=1,
                  deformable_groups=1,
-                 bias=True):
-        super(ModulatedDeformConvPack,
-              self).__init__(in_channels, out_channels, kernel_size, stride,
-                             padding, dilation, deformable_groups, bias)
+                 bias=True,
+                 deterministic=False):
+        super(ModulatedDeformConvPack, self).__init__(
+            in_channels, out_channels, kernel_size, stride, padding, dilation,
+            deformable_groups, bias, deterministic)
 
         self.conv_offset_mask = nn.Conv2d(
             self.in_channels,
@@ -123,6 +132,7 @@ class ModulatedDeformConvPack(ModulatedDeformConv):
         o1, o2, mask = torch.chunk(out, 3, dim=1)
         offset = torch.cat((o1, o2), dim=1)
         mask = torch.sigmoid(mask)
-        return modulated_deform_conv(input, offset, mask, self.weight,
-                                     self.bias, self.stride, self.padding,
-                                     self.dilation, self.deformable_groups)
+        return modulated_deform_conv(
+            input, offset, mask, self.weight, self.bias, self.stride,
+            self.padding, self.dilation, self.deformable_groups,
+            self.deterministic)
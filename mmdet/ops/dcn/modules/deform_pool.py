@@ -13,7 +13,8 @@ class DeformRoIPooling(nn.Module):
                  group_size=1,
                  part_size=None,
                  sample_per_part=4,
-                 trans_std=.0):
+                 trans_std=.0,
+                 reorder=False):
         super(DeformRoIPooling, self).__init__()
         self.spatial_scale = spatial_scale
         self.out_size = out_size
@@ -23,6 +24,7 @@ class DeformRoIPooling(nn.Module):
         self.part_size = out_size if part_size is None else part_size
         self.sample_per_part = sample_per_part
         self.trans_std = trans_std
+        self.reorder = reorder
 
     def forward(self, data, rois, offset):
         if self.no_trans:
@@ -30,7 +32,7 @@ class DeformRoIPooling(nn.Module):
         return deform_roi_pooling(
             data, rois, offset, self.spatial_scale, self.out_size,
             self.out_channels, self.no_trans, self.group_size, self.part_size,
-            self.sample_per_part, self.trans_std)
+            self.sample_per_part, self.trans_std, self.reorder)
 
 
 class DeformRoIPoolingPack(DeformRoIPooling):
@@ -44,10 +46,11 @@ class DeformRoIPoolingPack(DeformRoIPooling):
                  part_size=None,
                  sample_per_part=4,
                  trans_std=.0,
-                 deform_fc_channels=1024):
-        super(DeformRoIPoolingPack,
-              self).__init__(spatial_scale, out_size, out_channels, no_trans,
-                             group_size, part_size, sample_per_part, trans_std)
+                 deform_fc_channels=1024,
+                 reorder=False):
+        super(DeformRoIPoolingPack, self).__init__(
+            spatial_scale, out_size, out_channels, no_trans, group_size,
+            part_size, sample_per_part, trans_std, reorder)
 
         self.deform_fc_channels = deform_fc_channels
 
@@ -70,20 +73,23 @@ class DeformRoIPoolingPack(DeformRoIPooling):
             return deform_roi_pooling(
                 data, rois, offset, self.spatial_scale, self.out_size,
                 self.out_channels, self.no_trans, self.group_size,
-                self.part_size, self.sample_per_part, self.trans_std)
+                self.part_size, self.sample_per_part, self.trans_std,
+                self.reorder)
         else:
             n = rois.shape[0]
             offset = data.new_empty(0)
             x = deform_roi_pooling(data, rois, offset, self.spatial_scale,
                                    self.out_size, self.out_channels, True,
                                    self.group_size, self.part_size,
-                                   self.sample_per_part, self.trans_std)
+                                   self.sample_per_part, self.trans_std,
+                                   self.reorder)
             offset = self.offset_fc(x.view(n, -1))
             offset = offset.view(n, 2, self.out_size, self.out_size)
             return deform_roi_pooling(
                 data, rois, offset, self.spatial_scale, self.out_size,
                 self.out_channels, self.no_trans, self.group_size,
-                self.part_size, self.sample_per_part, self.trans_std)
+                self.part_size, self.sample_per_part, self.trans_std,
+                self.reorder)
 
 
 class ModulatedDeformRoIPoolingPack(DeformRoIPooling):
@@ -97,10 +103,11 @@ class ModulatedDeformRoIPoolingPack(DeformRoIPooling):
                  part_size=None,
                  sample_per_part=4,
                  trans_std=.0,
-                 deform_fc_channels=1024):
+                 deform_fc_channels=1024,
+                 reorder=False):
         super(ModulatedDeformRoIPoolingPack, self).__init__(
             spatial_scale, out_size, out_channels, no_trans, group_size,
-            part_size, sample_per_part, trans_std)
+            part_size, sample_per_part, trans_std, reorder)
 
         self.deform_fc_channels = deform_fc_channels
 
@@ -132,14 +139,16 @@ class ModulatedDeformRoIPoolingPack(DeformRoIPooling):
             return deform_roi_pooling(
                 data, rois, offset, self.spatial_scale, self.out_size,
                 self.out_channels, self.no_trans, self.group_size,
-                self.part_size, self.sample_per_part, self.trans_std)
+                self.part_size, self.sample_per_part, self.trans_std,
+                self.reorder)
         else:
             n = rois.shape[0]
             offset = data.new_empty(0)
             x = deform_roi_pooling(data, rois, offset, self.spatial_scale,
                                    self.out_size, self.out_channels, True,
                                    self.group_size, self.part_size,
-                                   self.sample_per_part, self.trans_std)
+                                   self.sample_per_part, self.trans_std,
+                                   self.reorder)
             offset = self.offset_fc(x.view(n, -1))
             offset = offset.view(n, 2, self.out_size, self.out_size)
             mask = self.mask_fc(x.view(n, -1))
@@ -147,4 +156,5 @@ class ModulatedDeformRoIPoolingPack(DeformRoIPooling):
             return deform_roi_pooling(
                 data, rois, offset, self.spatial_scale, self.out_size,
                 self.out_channels, self.no_trans, self.group_size,
-                self.part_size, self.sample_per_part, self.trans_std) * mask
+                self.part_size, self.sample_per_part, self.trans_std,
+                self.reorder) * mask
@@ -1,13 +1,31 @@
+import os.path as osp
+
 from setuptools import setup
-from torch.utils.cpp_extension import BuildExtension, CUDAExtension
+from torch.utils.cpp_extension import (BuildExtension, CppExtension,
+                                       CUDAExtension)
+
+# cpu_utils.h, shared by the CPU implementations of the ops
+common_dir = osp.join(osp.dirname(osp.abspath(__file__)), '..', 'common')
 
 setup(
     name='deform_conv',
     ext_modules=[
-        CUDAExtension('deform_conv_cuda', [
-            'src/deform_conv_cuda.cpp',
-            'src/deform_conv_cuda_kernel.cu',
-        ]),
+        # the host code in deform_conv_cuda.cpp drives either the CUDA or,
+        # without WITH_CUDA (deform_conv_cpu.cpp), the CPU kernels
+        CUDAExtension(
+            'deform_conv_cuda', [
+                'src/deform_conv_cuda.cpp',
+                'src/deform_conv_cuda_kernel.cu',
+            ],
+            define_macros=[('WITH_CUDA', None)]),
+        CppExtension(
+            'deform_conv_cpu', [
+                'src/deform_conv_cpu.cpp',
+                'src/deform_conv_cpu_kernel.cpp',
+            ],
+            include_dirs=[common_dir],
+            extra_compile_args=['-O3', '-fopenmp'],
+            extra_link_args=['-fopenmp']),
         CUDAExtension('deform_pool_cuda', [
             'src/deform_pool_cuda.cpp', 'src/deform_pool_cuda_kernel.cu'
         ]),
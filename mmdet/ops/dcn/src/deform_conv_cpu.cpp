@@ -0,0 +1,4 @@
+// The host code of deform_conv_cuda.cpp built without WITH_CUDA, i.e. with
+// the CPU kernels, into deform_conv_cpu. It is a separate file so that its
+// object file does not collide with the one of deform_conv_cuda.
+#include "deform_conv_cuda.cpp"
@@ -0,0 +1,331 @@
+// CPU counterparts of the kernels in deform_conv_cuda_kernel.cu, they follow
+// the same column layout so that deform_conv_cuda.cpp can drive both.
+//
+// The input, offset and mask (and their gradients) may be stored in fp16,
+// which halves the memory traffic of the gathers. Sampling, interpolation and
+// all the sums are done in the accumulation type acc_t (fp32 for fp16), which
+// is also the type of the columns that feed the GEMMs.
+
+#include <ATen/ATen.h>
+#include <ATen/Parallel.h>
+
+#include <cmath>
+#include <vector>
+
+#include "cpu_utils.h"
+
+template <typename scalar_t, typename acc_t>
+static inline acc_t im2col_bilinear_cpu(const scalar_t *bottom_data,
+                                        const int height, const int width,
+                                        acc_t h, acc_t w) {
+  int h_low = floor(h);
+  int w_low = floor(w);
+  int h_high = h_low + 1;
+  int w_high = w_low + 1;
+
+  acc_t lh = h - h_low;
+  acc_t lw = w - w_low;
+  acc_t hh = 1 - lh, hw = 1 - lw;
+
+  acc_t v1 = 0;
+  if (h_low >= 0 && w_low >= 0) v1 = bottom_data[h_low * width + w_low];
+  acc_t v2 = 0;
+  if (h_low >= 0 && w_high <= width - 1)
+    v2 = bottom_data[h_low * width + w_high];
+  acc_t v3 = 0;
+  if (h_high <= height - 1 && w_low >= 0)
+    v3 = bottom_data[h_high * width + w_low];
+  acc_t v4 = 0;
+  if (h_high <= height - 1 && w_high <= width - 1)
+    v4 = bottom_data[h_high * width + w_high];
+
+  acc_t w1 = hh * hw, w2 = hh * lw, w3 = lh * hw, w4 = lh * lw;
+
+  return w1 * v1 + w2 * v2 + w3 * v3 + w4 * v4;
+}
+
+// data_mask is NULL for the (unmodulated) deformable convolution
+template <typename scalar_t, typename acc_t>
+void deformable_im2col_cpu_kernel(
+    const scalar_t *data_im, const scalar_t *data_offset,
+    const scalar_t *data_mask, const int height, const int width,
+    const int kernel_h, const int kernel_w, const int pad_h, const int pad_w,
+    const int stride_h, const int stride_w, const int dilation_h,
+    const int dilation_w, const int channel_per_deformable_group,
+    const int batch_size, const int num_channels, const int deformable_group,
+    const int height_col, const int width_col, acc_t *data_col) {
+  const int kernel_size = kernel_h * kernel_w;
+  const int col_plane = height_col * width_col;
+  // one work item per (input channel, image) row block of the columns
+  at::parallel_for(0, num_channels * batch_size, 1, [&](int64_t begin,
+                                                        int64_t end) {
+    for (int64_t index = begin; index < end; ++index) {
+      const int b_col = index % batch_size;
+      const int c_im = index / batch_size;
+      const int deformable_group_index = c_im / channel_per_deformable_group;
+      const int bg = b_col * deformable_group + deformable_group_index;
+
+      const scalar_t *data_im_ptr =
+          data_im + (b_col * num_channels + c_im) * height * width;
+      const scalar_t *data_offset_ptr =
+          data_offset + bg * 2 * kernel_size * col_plane;
+      const scalar_t *data_mask_ptr =
+          data_mask != NULL ? data_mask + bg * kernel_size * col_plane : NULL;
+
+      for (int k = 0; k < kernel_size; ++k) {
+        const int i = k / kernel_w;
+        const int j = k % kernel_w;
+        acc_t *data_col_ptr =
+            data_col +
+            ((c_im * kernel_size + k) * batch_size + b_col) * col_plane;
+        for (int h_col = 0; h_col < height_col; ++h_col) {
+          for (int w_col = 0; w_col < width_col; ++w_col) {
+            const int col_hw = h_col * width_col + w_col;
+            const acc_t offset_h =
+                data_offset_ptr[2 * k * col_plane + col_hw];
+            const acc_t offset_w =
+                data_offset_ptr[(2 * k + 1) * col_plane + col_hw];
+            const acc_t h_im =
+                h_col * stride_h - pad_h + i * dilation_h + offset_h;
+            const acc_t w_im =
+                w_col * stride_w - pad_w + j * dilation_w + offset_w;
+            acc_t val = 0;
+            if (h_im > -1 && w_im > -1 && h_im < height && w_im < width) {
+              val = im2col_bilinear_cpu(data_im_ptr, height, width, h_im,
+                                        w_im);
+            }
+            if (data_mask_ptr != NULL) {
+              val *= static_cast<acc_t>(data_mask_ptr[k * col_plane + col_hw]);
+            }
+            data_col_ptr[col_hw] = val;
+          }
+        }
+      }
+    }
+  });
+}
+
+void deformable_im2col_cpu(
+    const at::Tensor data_im, const at::Tensor data_offset, const int channels,
+    const int height, const int width, const int ksize_h, const int ksize_w,
+    const int pad_h, const int pad_w, const int stride_h, const int stride_w,
+    const int dilation_h, const int dilation_w, const int parallel_imgs,
+    const int deformable_group, at::Tensor data_col) {
+  int height_col =
+      (height + 2 * pad_h - (dilation_h * (ksize_h - 1) + 1)) / stride_h + 1;
+  int width_col =
+      (width + 2 * pad_w - (dilation_w * (ksize_w - 1) + 1)) / stride_w + 1;
+  int channel_per_deformable_group = channels / deformable_group;
+
+  AT_DISPATCH_FLOATING_TYPES_AND_HALF(
+      data_im.type(), "deformable_im2col_cpu", ([&] {
+        typedef typename acc_type<scalar_t>::type acc_t;
+        deformable_im2col_cpu_kernel<scalar_t, acc_t>(
+            data_im.data<scalar_t>(), data_offset.data<scalar_t>(), NULL,
+            height, width, ksize_h, ksize_w, pad_h, pad_w, stride_h, stride_w,
+            dilation_h, dilation_w, channel_per_deformable_group,
+            parallel_imgs, channels, deformable_group, height_col, width_col,
+            data_col.data<acc_t>());
+      }));
+}
+
+void modulated_deformable_im2col_cpu(
+    const at::Tensor data_im, const at::Tensor data_offset,
+    const at::Tensor data_mask, const int batch_size, const int channels,
+    const int height_im, const int width_im, const int height_col,
+    const int width_col, const int kernel_h, const int kernel_w,
+    const int pad_h, const int pad_w, const int stride_h, const int stride_w,
+    const int dilation_h, const int dilation_w, const int deformable_group,
+    at::Tensor data_col) {
+  const int channel_per_deformable_group = channels / deformable_group;
+
+  AT_DISPATCH_FLOATING_TYPES_AND_HALF(
+      data_im.type(), "modulated_deformable_im2col_cpu", ([&] {
+        typedef typename acc_type<scalar_t>::type acc_t;
+        deformable_im2col_cpu_kernel<scalar_t, acc_t>(
+            data_im.data<scalar_t>(), data_offset.data<scalar_t>(),
+            data_mask.data<scalar_t>(), height_im, width_im, kernel_h,
+            kernel_w, pad_h, pad_w, stride_h, stride_w, dilation_h,
+            dilation_w, channel_per_deformable_group, batch_size, channels,
+            deformable_group, height_col, width_col,
+            data_col.data<acc_t>());
+      }));
+}
+
+// Bilinear corners of a sampling point, relative to a channel plane. The
+// weights already include the modulation mask, invalid corners have pos -1.
+template <typename acc_t>
+struct SamplingPoint {
+  int pos[4];
+  acc_t weight[4];
+};
+
+// Fused backward of the deformable im2col. Sampling locations are computed
+// once per (image, deformable group, kernel position, output position) and
+// used for two passes that each own their outputs:
+//  1. over sampling points: gradients w.r.t. offset and mask, summed over the
+//     channels of the deformable group;
+//  2. over (image, channel) planes: gradients w.r.t. the input, scattered in
+//     a fixed order.
+// Neither pass needs atomics, so the result is deterministic.
+template <typename scalar_t, typename acc_t>
+void deformable_col2im_fused_cpu_kernel(
+    const acc_t *data_col, const scalar_t *data_im,
+    const scalar_t *data_offset, const scalar_t *data_mask, const int channels,
+    const int height, const int width, const int kernel_h, const int kernel_w,
+    const int pad_h, const int pad_w, const int stride_h, const int stride_w,
+    const int dilation_h, const int dilation_w,
+    const int channel_per_deformable_group, const int batch_size,
+    const int deformable_group, const int height_col, const int width_col,
+    scalar_t *grad_im, scalar_t *grad_offset, scalar_t *grad_mask) {
+  const int kernel_size = kernel_h * kernel_w;
+  const int col_plane = height_col * width_col;
+  const int im_plane = height * width;
+  const int points_per_group = kernel_size * col_plane;
+  const int64_t num_points =
+      static_cast<int64_t>(batch_size) * deformable_group * points_per_group;
+  std::vector<SamplingPoint<acc_t>> points(num_points);
+
+  at::parallel_for(0, num_points, 1024, [&](int64_t begin, int64_t end) {
+    for (int64_t index = begin; index < end; ++index) {
+      const int col_hw = index % col_plane;
+      const int k = (index / col_plane) % kernel_size;
+      const int bg = index / points_per_group;
+      const int b = bg / deformable_group;
+      const int deformable_group_index = bg % deformable_group;
+      const int h_out = col_hw / width_col;
+      const int w_out = col_hw % width_col;
+      const int i = k / kernel_w;
+      const int j = k % kernel_w;
+
+      const scalar_t *data_offset_ptr =
+          data_offset + bg * 2 * kernel_size * col_plane;
+      const acc_t offset_h = data_offset_ptr[2 * k * col_plane + col_hw];
+      const acc_t offset_w = data_offset_ptr[(2 * k + 1) * col_plane + col_hw];
+      const acc_t mask =
+          data_mask != NULL
+              ? static_cast<acc_t>(
+                    data_mask[(bg * kernel_size + k) * col_plane + col_hw])
+              : static_cast<acc_t>(1);
+      const acc_t h_im = h_out * stride_h - pad_h + i * dilation_h + offset_h;
+      const acc_t w_im = w_out * stride_w - pad_w + j * dilation_w + offset_w;
+
+      SamplingPoint<acc_t> &point = points[index];
+      acc_t grad_h = 0, grad_w = 0, grad_m = 0;
+      for (int n = 0; n < 4; ++n) {
+        point.pos[n] = -1;
+        point.weight[n] = 0;
+      }
+      if (h_im > -1 && w_im > -1 && h_im < height && w_im < width) {
+        const int h_low = floor(h_im);
+        const int w_low = floor(w_im);
+        const int h_high = h_low + 1;
+        const int w_high = w_low + 1;
+        const acc_t lh = h_im - h_low;
+        const acc_t lw = w_im - w_low;
+        const acc_t hh = 1 - lh, hw = 1 - lw;
+        const acc_t w[4] = {hh * hw, hh * lw, lh * hw, lh * lw};
+        if (h_low >= 0 && w_low >= 0) point.pos[0] = h_low * width + w_low;
+        if (h_low >= 0 && w_high <= width - 1)
+          point.pos[1] = h_low * width + w_high;
+        if (h_high <= height - 1 && w_low >= 0)
+          point.pos[2] = h_high * width + w_low;
+        if (h_high <= height - 1 && w_high <= width - 1)
+          point.pos[3] = h_high * width + w_high;
+        for (int n = 0; n < 4; ++n) point.weight[n] = w[n] * mask;
+
+        const int c_begin =
+            deformable_group_index * channel_per_deformable_group;
+        const acc_t *data_col_ptr =
+            data_col + ((c_begin * kernel_size + k) * batch_size + b) *
+                           col_plane + col_hw;
+        const int col_step = kernel_size * batch_size * col_plane;
+        const scalar_t *data_im_ptr =
+            data_im + (b * channels + c_begin) * im_plane;
+        for (int c = 0; c < channel_per_deformable_group; ++c) {
+          const acc_t col = data_col_ptr[c * col_step];
+          acc_t v[4];
+          for (int n = 0; n < 4; ++n) {
+            v[n] = point.pos[n] >= 0
+                       ? static_cast<acc_t>(data_im_ptr[point.pos[n]])
+                       : acc_t(0);
+          }
+          grad_h += (hw * (v[2] - v[0]) + lw * (v[3] - v[1])) * col;
+          grad_w += (hh * (v[1] - v[0]) + lh * (v[3] - v[2])) * col;
+          grad_m += (w[0] * v[0] + w[1] * v[1] + w[2] * v[2] + w[3] * v[3]) *
+                    col;
+          data_im_ptr += im_plane;
+        }
+      }
+
+      scalar_t *grad_offset_ptr =
+          grad_offset + bg * 2 * kernel_size * col_plane;
+      grad_offset_ptr[2 * k * col_plane + col_hw] =
+          static_cast<scalar_t>(grad_h * mask);
+      grad_offset_ptr[(2 * k + 1) * col_plane + col_hw] =
+          static_cast<scalar_t>(grad_w * mask);
+      if (grad_mask != NULL) {
+        grad_mask[(bg * kernel_size + k) * col_plane + col_hw] =
+            static_cast<scalar_t>(grad_m);
+      }
+    }
+  });
+
+  at::parallel_for(0, batch_size * channels, 1, [&](int64_t begin,
+                                                    int64_t end) {
+    Accumulator<scalar_t, acc_t> accumulator;
+    for (int64_t index = begin; index < end; ++index) {
+      const int b = index / channels;
+      const int c = index % channels;
+      const int deformable_group_index = c / channel_per_deformable_group;
+      const SamplingPoint<acc_t> *point =
+          points.data() +
+          (b * deformable_group + deformable_group_index) * points_per_group;
+      acc_t *grad_im_ptr =
+          accumulator.begin(grad_im + index * im_plane, im_plane);
+      for (int k = 0; k < kernel_size; ++k) {
+        const acc_t *data_col_ptr =
+            data_col + ((c * kernel_size + k) * batch_size + b) * col_plane;
+        for (int col_hw = 0; col_hw < col_plane; ++col_hw, ++point) {
+          const acc_t col = data_col_ptr[col_hw];
+          for (int n = 0; n < 4; ++n) {
+            if (point->pos[n] >= 0) {
+              grad_im_ptr[point->pos[n]] += point->weight[n] * col;
+            }
+          }
+        }
+      }
+      accumulator.end();
+    }
+  });
+}
+
+// The CPU backward is always deterministic, the flag only exists to keep the
+// signature in line with deformable_col2im_fused.
+void deformable_col2im_fused_cpu(
+    const at::Tensor data_col, const at::Tensor data_im,
+    const at::Tensor data_offset, const at::Tensor data_mask,
+    const int batch_size, const int channels, const int height_im,
+    const int width_im, const int height_col, const int width_col,
+    const int kernel_h, const int kernel_w, const int pad_h, const int pad_w,
+    const int stride_h, const int stride_w, const int dilation_h,
+    const int dilation_w, const int deformable_group,
+    const bool deterministic, at::Tensor grad_im, at::Tensor grad_offset,
+    at::Tensor grad_mask) {
+  const int channel_per_deformable_group = channels / deformable_group;
+  const bool modulated = data_mask.defined();
+
+  AT_DISPATCH_FLOATING_TYPES_AND_HALF(
+      data_im.type(), "deformable_col2im_fused_cpu", ([&] {
+        typedef typename acc_type<scalar_t>::type acc_t;
+        deformable_col2im_fused_cpu_kernel<scalar_t, acc_t>(
+            data_col.data<acc_t>(), data_im.data<scalar_t>(),
+            data_offset.data<scalar_t>(),
+            modulated ? data_mask.data<scalar_t>() : NULL, channels,
+            height_im, width_im, kernel_h, kernel_w, pad_h, pad_w, stride_h,
+            stride_w, dilation_h, dilation_w, channel_per_deformable_group,
+            batch_size, deformable_group, height_col, width_col,
+            grad_im.data<scalar_t>(), grad_offset.data<scalar_t>(),
+            modulated ? grad_mask.data<scalar_t>() : NULL);
+      }));
+}
@@ -5,6 +5,10 @@
 #include <cmath>
 #include <vector>
 
+// This file is built twice: with WITH_CUDA and the CUDA kernels into
+// deform_conv_cuda, and without it (through deform_conv_cpu.cpp) and with the
+// CPU kernels into deform_conv_cpu, a C++ extension built with OpenMP.
+#ifdef WITH_CUDA
 void deformable_im2col(const at::Tensor data_im,
                        const at::Tensor data_offset, const int channels,
                        const int height, const int width, const int ksize_h,
@@ -12,26 +16,8 @@ void deformable_im2col(const at::Tensor data_im,
                        const int stride_h, const int stride_w,
                        const int dilation_h, const int dilation_w,
                        const int parallel_imgs,
-                       const int deformable_group, at::Tensor data_col);
-
-void deformable_col2im(const at::Tensor data_col,
-                       const at::Tensor data_offset, const int channels,
-                       const int height, const int width, const int ksize_h,
-                       const int ksize_w, const int pad_h, const int pad_w,
-                       const int stride_h, const int stride_w,
-                       const int dilation_h, const int dilation_w,
-                       const int parallel_imgs,
-                       const int deformable_group, at::Tensor grad_im);
-
-void deformable_col2im_coord(const at::Tensor data_col,
-                             const at::Tensor data_im, const at::Tensor data_offset,
-                             const int channels, const int height,
-                             const int width, const int ksize_h,
-                             const int ksize_w, const int pad_h,
-                             const int pad_w, const int stride_h,
-                             const int stride_w, const int dilation_h,
-                             const int dilation_w, const int parallel_imgs,
-                             const int deformable_group, at::Tensor grad_offset);
+                       const int deformable_group, at::Tensor data_col,
+                       const int threads_per_block);
 
 void modulated_deformable_im2col_cuda(const at::Tensor data_im, const at::Tensor data_offset,
                                       const at::Tensor data_mask, const int batch_size, const int channels,
@@ -39,25 +25,139 @@ void modulated_deformable_im2col_cuda(const at::Tensor data_im, const at::Tensor
                                       const int width_col, const int kernel_h, const int kenerl_w,
                                       const int pad_h, const int pad_w, const int stride_h, const int stride_w,
                                       const int dilation_h, const int dilation_w,
-                                      const int deformable_group, at::Tensor data_col);
+                                      const int deformable_group, at::Tensor data_col,
+                                      const int threads_per_block);
+
+void deformable_col2im_fused(const at::Tensor data_col, const at::Tensor data_im,
+                             const at::Tensor data_offset, const at::Tensor data_mask,
+                             const int batch_size, const int channels, const int height_im,
+                             const int width_im, const int height_col, const int width_col,
+                             const int kernel_h, const int kernel_w, const int pad_h,
+                             const int pad_w, const int stride_h, const int stride_w,
+                             const int dilation_h, const int dilation_w,
+                             const int deformable_group, const bool deterministic,
+                             at::Tensor grad_im, at::Tensor grad_offset, at::Tensor grad_mask,
+                             const int threads_per_block);
+#else
+void deformable_im2col_cpu(const at::Tensor data_im,
+                           const at::Tensor data_offset, const int channels,
+                           const int height, const int width, const int ksize_h,
+                           const int ksize_w, const int pad_h, const int pad_w,
+                           const int stride_h, const int stride_w,
+                           const int dilation_h, const int dilation_w,
+                           const int parallel_imgs,
+                           const int deformable_group, at::Tensor data_col);
+
+void modulated_deformable_im2col_cpu(const at::Tensor data_im, const at::Tensor data_offset,
+                                     const at::Tensor data_mask, const int batch_size, const int channels,
+                                     const int height_im, const int width_im, const int height_col,
+                                     const int width_col, const int kernel_h, const int kenerl_w,
+                                     const int pad_h, const int pad_w, const int stride_h, const int stride_w,
+                                     const int dilation_h, const int dilation_w,
+                                     const int deformable_group, at::Tensor data_col);
+
+void deformable_col2im_fused_cpu(const at::Tensor data_col, const at::Tensor data_im,
+                                 const at::Tensor data_offset, const at::Tensor data_mask,
+                                 const int batch_size, const int channels, const int height_im,
+                                 const int width_im, const int height_col, const int width_col,
+                                 const int kernel_h, const int kernel_w, const int pad_h,
+                                 const int pad_w, const int stride_h, const int stride_w,
+                                 const int dilation_h, const int dilation_w,
+                                 const int deformable_group, const bool deterministic,
+                                 at::Tensor grad_im, at::Tensor grad_offset, at::Tensor grad_mask);
+#endif
+
+// The functions below only drive the kernels and are shared by CPU and CUDA
+// tensors, these call the kernels of the device this extension is built for.
+// threads_per_block is the (tuned) block size of the CUDA kernels.
+#ifdef WITH_CUDA
+#define CHECK_DEVICE(x) \
+    AT_CHECK(x.type().is_cuda(), #x, " must be a CUDA tensor, CPU tensors use deform_conv_cpu")
+#else
+#define CHECK_DEVICE(x) \
+    AT_CHECK(!x.type().is_cuda(), #x, " must be a CPU tensor, CUDA tensors use deform_conv_cuda")
+#endif
+
+void deformable_im2col_dispatch(const at::Tensor data_im,
+                                const at::Tensor data_offset, const int channels,
+                                const int height, const int width, const int ksize_h,
+                                const int ksize_w, const int pad_h, const int pad_w,
+                                const int stride_h, const int stride_w,
+                                const int dilation_h, const int dilation_w,
+                                const int parallel_imgs,
+                                const int deformable_group, at::Tensor data_col,
+                                const int threads_per_block)
+{
+    CHECK_DEVICE(data_im);
+#ifdef WITH_CUDA
+    deformable_im2col(data_im, data_offset, channels, height, width, ksize_h, ksize_w,
+                      pad_h, pad_w, stride_h, stride_w, dilation_h, dilation_w,
+                      parallel_imgs, deformable_group, data_col, threads_per_block);
+#else
+    deformable_im2col_cpu(data_im, data_offset, channels, height, width, ksize_h, ksize_w,
+                          pad_h, pad_w, stride_h, stride_w, dilation_h, dilation_w,
+                          parallel_imgs, deformable_group, data_col);
+#endif
+}
 
-void modulated_deformable_col2im_cuda(const at::Tensor data_col, const at::Tensor data_offset,
-                                      const at::Tensor data_mask, const int batch_size, const int channels,
-                                      const int height_im, const int width_im, const int height_col,
-                                      const int width_col, const int kernel_h, const int kenerl_w,
-                                      const int pad_h, const int pad_w, const int stride_h, const int stride_w,
+void modulated_deformable_im2col_dispatch(const at::Tensor data_im, const at::Tensor data_offset,
+                                          const at::Tensor data_mask, const int batch_size, const int channels,
+                                          const int height_im, const int width_im, const int height_col,
+                                          const int width_col, const int kernel_h, const int kernel_w,
+                                          const int pad_h, const int pad_w, const int stride_h, const int stride_w,
+                                          const int dilation_h, const int dilation_w,
+                                          const int deformable_group, at::Tensor data_col,
+                                          const int threads_per_block)
+{
+    CHECK_DEVICE(data_im);
+#ifdef WITH_CUDA
+    modulated_deformable_im2col_cuda(data_im, data_offset, data_mask, batch_size, channels,
+                                     height_im, width_im, height_col, width_col, kernel_h, kernel_w,
+                                     pad_h, pad_w, stride_h, stride_w, dilation_h, dilation_w,
+                                     deformable_group, data_col, threads_per_block);
+#else
+    modulated_deformable_im2col_cpu(data_im, data_offset, data_mask, batch_size, channels,
+                                    height_im, width_im, height_col, width_col, kernel_h, kernel_w,
+                                    pad_h, pad_w, stride_h, stride_w, dilation_h, dilation_w,
+                                    deformable_group, data_col);
+#endif
+}
+
+// data_mask and grad_mask are undefined tensors for the unmodulated version
+void deformable_col2im_fused_dispatch(const at::Tensor data_col, const at::Tensor data_im,
+                                      const at::Tensor data_offset, const at::Tensor data_mask,
+                                      const int batch_size, const int channels, const int height_im,
+                                      const int width_im, const int height_col, const int width_col,
+                                      const int kernel_h, const int kernel_w, const int pad_h,
+                                      const int pad_w, const int stride_h, const int stride_w,
                                       const int dilation_h, const int dilation_w,
-                                      const int deformable_group, at::Tensor grad_im);
-
-void modulated_deformable_col2im_coord_cuda(const at::Tensor data_col, const at::Tensor data_im,
-                                            const at::Tensor data_offset, const at::Tensor data_mask,
-                                            const int batch_size, const int channels, const int height_im,
-                                            const int width_im, const int height_col, const int width_col,
-                                            const int kernel_h, const int kenerl_w, const int pad_h,
-                                            const int pad_w, const int stride_h, const int stride_w,
-                                            const int dilation_h, const int dilation_w,
-                                            const int deformable_group, at::Tensor grad_offset,
-                                            at::Tensor grad_mask);
+                                      const int deformable_group, const bool deterministic,
+                                      at::Tensor grad_im, at::Tensor grad_offset, at::Tensor grad_mask,
+                                      const int threads_per_block)
+{
+    CHECK_DEVICE(data_col);
+#ifdef WITH_CUDA
+    deformable_col2im_fused(data_col, data_im, data_offset, data_mask, batch_size, channels,
+                            height_im, width_im, height_col, width_col, kernel_h, kernel_w,
+                            pad_h, pad_w, stride_h, stride_w, dilation_h, dilation_w,
+                            deformable_group, deterministic, grad_im, grad_offset, grad_mask,
+                            threads_per_block);
+#else
+    deformable_col2im_fused_cpu(data_col, data_im, data_offset, data_mask, batch_size, channels,
+                                height_im, width_im, height_col, width_col, kernel_h, kernel_w,
+                                pad_h, pad_w, stride_h, stride_w, dilation_h, dilation_w,
+                                deformable_group, deterministic, grad_im, grad_offset, grad_mask);
+#endif
+}
+
+// fp16 CPU tensors only store the data, the columns and the GEMMs use fp32
+// (which the weights must have) since there is no fp16 BLAS on the CPU.
+at::Type &compute_type(const at::Tensor &input)
+{
+    if (!input.type().is_cuda() && input.type().scalarType() == at::kHalf)
+        return input.type().toScalarType(at::kFloat);
+    return input.type();
+}
 
 void shape_check(at::Tensor input, at::Tensor offset,
                  at::Tensor *gradOutput, at::Tensor weight, int kH, int kW,
@@ -155,7 +255,8 @@ int deform_conv_forward_cuda(at::Tensor input, at::Tensor weight,
                              at::Tensor columns, at::Tensor ones, int kW,
                              int kH, int dW, int dH, int padW, int padH,
                              int dilationW, int dilationH,
-                             int deformable_group, int im2col_step)
+                             int deformable_group, int im2col_step,
+                             int threads_per_block)
 {
 
     // todo: resize columns to include im2col: done
@@ -170,6 +271,10 @@ int deform_conv_forward_cuda(at::Tensor input, at::Tensor weight,
     offset = offset.contiguous();
     weight = weight.contiguous();
 
+    at::Type &acc = compute_type(input);
+    AT_CHECK(weight.type().scalarType() == acc.scalarType(),
+             "weight must have the accumulation type of input");
+
     int batch = 1;
     if (input.ndimension() == 3)
     {
@@ -194,25 +299,26 @@ int deform_conv_forward_cuda(at::Tensor input, at::Tensor weight,
     AT_CHECK((offset.size(0) == batchSize), "invalid batch size of offset");
 
     output = output.view({batchSize / im2col_step, im2col_step, nOutputPlane, outputHeight, outputWidth});
-    columns = at::zeros({nInputPlane * kW * kH, im2col_step * outputHeight * outputWidth}, input.type());
+    columns = at::zeros({nInputPlane * kW * kH, im2col_step * outputHeight * outputWidth}, acc);
 
     if (ones.ndimension() != 2 || ones.size(0) * ones.size(1) < outputHeight * outputWidth)
     {
-        ones = at::ones({outputHeight, outputWidth}, input.type());
+        ones = at::ones({outputHeight, outputWidth}, acc);
     }
 
     input = input.view({batchSize / im2col_step, im2col_step, nInputPlane, inputHeight, inputWidth});
     offset = offset.view({batchSize / im2col_step, im2col_step,
                           deformable_group * 2 * kH * kW, outputHeight, outputWidth});
 
-    at::Tensor output_buffer = at::zeros({batchSize / im2col_step, nOutputPlane, im2col_step * outputHeight, outputWidth}, output.type());
+    // the copy to output converts to its dtype
+    at::Tensor output_buffer = at::zeros({batchSize / im2col_step, nOutputPlane, im2col_step * outputHeight, outputWidth}, acc);
 
     for (int elt = 0; elt < batchSize / im2col_step; elt++)
     {
-        deformable_im2col(
+        deformable_im2col_dispatch(
             input[elt], offset[elt], nInputPlane, inputHeight,
             inputWidth, kH, kW, padH, padW, dH, dW, dilationH, dilationW,
-            im2col_step, deformable_group, columns);
+            im2col_step, deformable_group, columns, threads_per_block);
 
         output_buffer[elt] =
             output_buffer[elt].flatten(1).addmm_(weight.flatten(1), columns).view_as(output_buffer[elt]);
@@ -241,7 +347,8 @@ int deform_conv_backward_input_cuda(
     at::Tensor input, at::Tensor offset, at::Tensor gradOutput,
     at::Tensor gradInput, at::Tensor gradOffset, at::Tensor weight,
     at::Tensor columns, int kW, int kH, int dW, int dH, int padW, int padH,
-    int dilationW, int dilationH, int deformable_group, int im2col_step)
+    int dilationW, int dilationH, int deformable_group, int im2col_step,
+    bool deterministic, int threads_per_block)
 {
 
     shape_check(input, offset, &gradOutput, weight, kH, kW, dH, dW, padH,
@@ -249,9 +356,13 @@ int deform_conv_backward_input_cuda(
 
     input = input.contiguous();
     offset = offset.contiguous();
-    gradOutput = gradOutput.contiguous();
     weight = weight.contiguous();
 
+    at::Type &acc = compute_type(input);
+    AT_CHECK(weight.type().scalarType() == acc.scalarType(),
+             "weight must have the accumulation type of input");
+    gradOutput = gradOutput.contiguous().toType(acc);
+
     int batch = 1;
 
     if (input.ndimension() == 3)
@@ -275,7 +386,7 @@ int deform_conv_backward_input_cuda(
 
     AT_CHECK((offset.size(0) == batchSize), 3, "invalid batch size of offset");
     gradInput = gradInput.view({batchSize, nInputPlane, inputHeight, inputWidth});
-    columns = at::zeros({nInputPlane * kW * kH, im2col_step * outputHeight * outputWidth}, input.type());
+    columns = at::zeros({nInputPlane * kW * kH, im2col_step * outputHeight * outputWidth}, acc);
 
     // change order of grad output
     gradOutput = gradOutput.view(
@@ -294,15 +405,12 @@ int deform_conv_backward_input_cuda(
     {
         columns = columns.addmm_(weight.flatten(1).transpose(0, 1), gradOutput[elt].flatten(1), 0.0f, 1.0f);
 
-        deformable_col2im_coord(
-            columns, input[elt], offset[elt],
-            nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
-            dilationH, dilationW, im2col_step, deformable_group, gradOffset[elt]);
-
-        deformable_col2im(
-            columns, offset[elt], nInputPlane, inputHeight,
-            inputWidth, kH, kW, padH, padW, dH, dW, dilationH, dilationW, im2col_step,
-            deformable_group, gradInput[elt]);
+        deformable_col2im_fused_dispatch(
+            columns, input[elt], offset[elt], at::Tensor(), im2col_step,
+            nInputPlane, inputHeight, inputWidth, outputHeight, outputWidth,
+            kH, kW, padH, padW, dH, dW, dilationH, dilationW, deformable_group,
+            deterministic, gradInput[elt], gradOffset[elt], at::Tensor(),
+            threads_per_block);
     }
 
     gradOutput.transpose_(1, 2);
@@ -330,7 +438,7 @@ int deform_conv_backward_parameters_cuda(
     at::Tensor gradWeight, // at::Tensor gradBias,
     at::Tensor columns, at::Tensor ones, int kW, int kH, int dW, int dH,
     int padW, int padH, int dilationW, int dilationH, int deformable_group,
-    float scale, int im2col_step)
+    float scale, int im2col_step, int threads_per_block)
 {
 
     // todo: transpose and reshape outGrad
@@ -342,7 +450,11 @@ int deform_conv_backward_parameters_cuda(
 
     input = input.contiguous();
     offset = offset.contiguous();
-    gradOutput = gradOutput.contiguous();
+
+    at::Type &acc = compute_type(input);
+    AT_CHECK(gradWeight.type().scalarType() == acc.scalarType(),
+             "gradWeight must have the accumulation type of input");
+    gradOutput = gradOutput.contiguous().toType(acc);
 
     int batch = 1;
 
@@ -367,7 +479,7 @@ int deform_conv_backward_parameters_cuda(
 
     AT_CHECK((offset.size(0) == batchSize), "invalid batch size of offset");
 
-    columns = at::zeros({nInputPlane * kW * kH, im2col_step * outputHeight * outputWidth}, input.type());
+    columns = at::zeros({nInputPlane * kW * kH, im2col_step * outputHeight * outputWidth}, acc);
 
     gradOutput = gradOutput.view(
         {batchSize / im2col_step, im2col_step, nOutputPlane, outputHeight, outputWidth});
@@ -390,10 +502,10 @@ int deform_conv_backward_parameters_cuda(
 
     for (int elt = 0; elt < batchSize / im2col_step; elt++)
     {
-        deformable_im2col(
+        deformable_im2col_dispatch(
             input[elt], offset[elt], nInputPlane, inputHeight,
             inputWidth, kH, kW, padH, padW, dH, dW, dilationH, dilationW,
-            im2col_step, deformable_group, columns);
+            im2col_step, deformable_group, columns, threads_per_block);
 
         gradWeight = gradWeight.flatten(1).addmm_(
                                               gradOutputBuffer[elt].flatten(1), columns.transpose(1, 0), 1.0, scale)
@@ -421,11 +533,16 @@ void modulated_deform_conv_cuda_forward(at::Tensor input, at::Tensor weight,
                                         const int stride_h, const int stride_w,
                                         const int pad_h, const int pad_w,
                                         const int dilation_h, const int dilation_w,
-                                        const int deformable_group, const bool with_bias)
+                                        const int deformable_group, const bool with_bias,
+                                        const int threads_per_block)
 {
     AT_CHECK(input.is_contiguous(), "input tensor has to be contiguous");
     AT_CHECK(weight.is_contiguous(), "weight tensor has to be contiguous");
 
+    at::Type &acc = compute_type(input);
+    AT_CHECK(weight.type().scalarType() == acc.scalarType(),
+             "weight must have the accumulation type of input");
+
     const int batch = input.size(0);
     const int channels = input.size(1);
     const int height = input.size(2);
@@ -450,28 +567,33 @@ void modulated_deform_conv_cuda_forward(at::Tensor input, at::Tensor weight,
         ones.size(0) * ones.size(1) < height_out * width_out)
     {
         // Resize plane and fill with ones...
-        ones = at::ones({height_out, width_out}, input.type());
+        ones = at::ones({height_out, width_out}, acc);
     }
 
-    // resize output
-    output = output.view({batch, channels_out, height_out, width_out}).zero_();
+    // resize output, it is accumulated in a buffer if it has another dtype
+    output = output.view({batch, channels_out, height_out, width_out});
+    const bool output_acc = output.type().scalarType() == acc.scalarType();
+    at::Tensor output_buffer =
+        output_acc ? output.zero_() : at::zeros(output.sizes(), acc);
     // resize temporary columns
-    columns = at::zeros({channels * kernel_h * kernel_w, 1 * height_out * width_out}, input.type());
+    columns = at::zeros({channels * kernel_h * kernel_w, 1 * height_out * width_out}, acc);
 
     for (int b = 0; b < batch; b++)
     {
-        modulated_deformable_im2col_cuda(input[b], offset[b], mask[b],
-                                         1, channels, height, width,
-                                         height_out, width_out, kernel_h, kernel_w,
-                                         pad_h, pad_w, stride_h, stride_w, dilation_h, dilation_w,
-                                         deformable_group, columns);
+        modulated_deformable_im2col_dispatch(input[b], offset[b], mask[b],
+                                             1, channels, height, width,
+                                             height_out, width_out, kernel_h, kernel_w,
+                                             pad_h, pad_w, stride_h, stride_w, dilation_h, dilation_w,
+                                             deformable_group, columns, threads_per_block);
 
-        output[b] = output[b].flatten(1).addmm_(weight.flatten(1), columns).view_as(output[b]);
+        output_buffer[b] = output_buffer[b].flatten(1).addmm_(weight.flatten(1), columns).view_as(output_buffer[b]);
     }
 
     if (with_bias){
-        output += bias.view({1, bias.size(0), 1, 1});
+        output_buffer += bias.view({1, bias.size(0), 1, 1});
     }
+    if (!output_acc)
+        output.copy_(output_buffer);
 }
 
 void modulated_deform_conv_cuda_backward(at::Tensor input, at::Tensor weight,
@@ -485,11 +607,17 @@ void modulated_deform_conv_cuda_backward(at::Tensor input, at::Tensor weight,
                                          int stride_h, int stride_w,
                                          int pad_h, int pad_w,
                                          int dilation_h, int dilation_w,
-                                         int deformable_group, const bool with_bias)
+                                         int deformable_group, const bool with_bias,
+                                         const bool deterministic, const int threads_per_block)
 {
     AT_CHECK(input.is_contiguous(), "input tensor has to be contiguous");
     AT_CHECK(weight.is_contiguous(), "weight tensor has to be contiguous");
 
+    at::Type &acc = compute_type(input);
+    AT_CHECK(weight.type().scalarType() == acc.scalarType(),
+             "weight must have the accumulation type of input");
+    grad_output = grad_output.toType(acc);
+
     const int batch = input.size(0);
     const int channels = input.size(1);
     const int height = input.size(2);
@@ -512,38 +640,32 @@ void modulated_deform_conv_cuda_backward(at::Tensor input, at::Tensor weight,
         ones.size(0) * ones.size(1) < height_out * width_out)
     {
         // Resize plane and fill with ones...
-        ones = at::ones({height_out, width_out}, input.type());
+        ones = at::ones({height_out, width_out}, acc);
     }
 
     grad_input = grad_input.view({batch, channels, height, width});
-    columns = at::zeros({channels * kernel_h * kernel_w, height_out * width_out}, input.type());
+    columns = at::zeros({channels * kernel_h * kernel_w, height_out * width_out}, acc);
 
     for (int b = 0; b < batch; b++)
     {
         columns.addmm_(weight.flatten(1).transpose(0, 1), grad_output[b].flatten(1), 0.0f, 1.0f);
 
-        // gradient w.r.t. input coordinate data
-        modulated_deformable_col2im_coord_cuda(columns, input[b], offset[b], mask[b],
-                                               1, channels, height, width,
-                                               height_out, width_out, kernel_h, kernel_w,
-                                               pad_h, pad_w, stride_h, stride_w,
-                                               dilation_h, dilation_w, deformable_group,
-                                               grad_offset[b], grad_mask[b]);
-        // gradient w.r.t. input data
-        modulated_deformable_col2im_cuda(columns, offset[b], mask[b],
+        // gradient w.r.t. input, input coordinate and mask data
+        deformable_col2im_fused_dispatch(columns, input[b], offset[b], mask[b],
                                          1, channels, height, width,
                                          height_out, width_out, kernel_h, kernel_w,
                                          pad_h, pad_w, stride_h, stride_w,
                                          dilation_h, dilation_w, deformable_group,
-                                         grad_input[b]);
+                                         deterministic, grad_input[b], grad_offset[b],
+                                         grad_mask[b], threads_per_block);
 
         // gradient w.r.t. weight, dWeight should accumulate across the batch and group
-        modulated_deformable_im2col_cuda(input[b], offset[b], mask[b],
-                                         1, channels, height, width,
-                                         height_out, width_out, kernel_h, kernel_w,
-                                         pad_h, pad_w, stride_h, stride_w,
-                                         dilation_h, dilation_w, deformable_group,
-                                         columns);
+        modulated_deformable_im2col_dispatch(input[b], offset[b], mask[b],
+                                             1, channels, height, width,
+                                             height_out, width_out, kernel_h, kernel_w,
+                                             pad_h, pad_w, stride_h, stride_w,
+                                             dilation_h, dilation_w, deformable_group,
+                                             columns, threads_per_block);
 
         grad_weight = grad_weight.flatten(1).addmm_(grad_output[b].flatten(1), columns.transpose(0, 1)).view_as(grad_weight);
 
@@ -555,13 +677,13 @@ void modulated_deform_conv_cuda_backward(at::Tensor input, at::Tensor weight,
 
 PYBIND11_MODULE(TORCH_EXTENSION_NAME, m)
 {
-    m.def("deform_conv_forward_cuda", &deform_conv_forward_cuda, "deform forward (CUDA)");
+    m.def("deform_conv_forward_cuda", &deform_conv_forward_cuda, "deform forward (CPU/CUDA)");
     m.def("deform_conv_backward_input_cuda", &deform_conv_backward_input_cuda,
-          "deform_conv_backward_input (CUDA)");
+          "deform_conv_backward_input (CPU/CUDA)");
     m.def("deform_conv_backward_parameters_cuda", &deform_conv_backward_parameters_cuda,
-          "deform_conv_backward_parameters (CUDA)");
+          "deform_conv_backward_parameters (CPU/CUDA)");
     m.def("modulated_deform_conv_cuda_forward", &modulated_deform_conv_cuda_forward,
-          "modulated deform conv forward (CUDA)");
+          "modulated deform conv forward (CPU/CUDA)");
     m.def("modulated_deform_conv_cuda_backward", &modulated_deform_conv_cuda_backward,
-          "modulated deform conv backward (CUDA)");
+          "modulated deform conv backward (CPU/CUDA)");
 }
@@ -0,0 +1,3 @@
+from .img_transform_wrapper import imnormalize_pad
+
+__all__ = ['imnormalize_pad']
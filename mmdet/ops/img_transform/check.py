@@ -0,0 +1,48 @@
+import mmcv
+import numpy as np
+import torch
+
+import os.path as osp
+import sys
+sys.path.append(osp.abspath(osp.join(__file__, '../../')))
+from img_transform import imnormalize_pad  # noqa: E402
+
+
+def reference(img, mean, std, to_rgb, flip, size_divisor):
+    img = mmcv.imnormalize(img, mean, std, to_rgb)
+    if flip:
+        img = mmcv.imflip(img)
+    if size_divisor is not None:
+        img = mmcv.impad_to_multiple(img, size_divisor)
+    return img.transpose(2, 0, 1), img.shape
+
+
+mean = np.array([123.675, 116.28, 103.53], dtype=np.float32)
+std = np.array([58.395, 57.12, 57.375], dtype=np.float32)
+rng = np.random.RandomState(0)
+# odd sizes, sizes already divisible and a single pixel
+shapes = [(37, 51), (800, 1201), (32, 64), (1, 1), (257, 3)]
+
+# the rows are split across the threads of torch, compare a single thread too
+num_threads = torch.get_num_threads()
+print('Equality of imnormalize_pad with mmcv...')
+for h, w in shapes:
+    img = rng.randint(0, 256, (h, w, 3)).astype(np.uint8)
+    for to_rgb in (True, False):
+        for flip in (False, True):
+            for size_divisor in (None, 32, 7):
+                for threads in (1, num_threads):
+                    torch.set_num_threads(threads)
+                    expected, pad_shape = reference(img, mean, std, to_rgb,
+                                                    flip, size_divisor)
+                    out, out_pad_shape = imnormalize_pad(
+                        img, mean, std, to_rgb, flip, size_divisor)
+                    assert out_pad_shape == pad_shape, (out_pad_shape,
+                                                        pad_shape)
+                    assert out.dtype == expected.dtype
+                    assert np.array_equal(out, expected), (
+                        'differs for shape {}, to_rgb={}, flip={}, '
+                        'size_divisor={}, threads={}'.format(
+                            (h, w), to_rgb, flip, size_divisor, threads))
+torch.set_num_threads(num_threads)
+print('OK')
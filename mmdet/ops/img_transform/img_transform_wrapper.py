@@ -0,0 +1,49 @@
+import numpy as np
+import torch
+
+from . import img_transform_cpu
+
+
+def imnormalize_pad(img,
+                    mean,
+                    std,
+                    to_rgb=True,
+                    flip=False,
+                    size_divisor=None):
+    """Normalize, flip, pad and transpose an image in a single pass.
+
+    It is equivalent to (and bitwise identical with) ``mmcv.imnormalize``,
+    ``mmcv.imflip``, ``mmcv.impad_to_multiple`` and ``transpose(2, 0, 1)``
+    applied in sequence, but writes directly into a preallocated buffer using
+    multiple threads and without holding the GIL.
+
+    The rows are split across the intra-op threads of torch, so the number
+    of threads is the one of ``torch.set_num_threads`` (dataloader workers
+    set it to 1, which keeps them from oversubscribing the cores).
+
+    Args:
+        img (ndarray): uint8 image of shape (h, w, 3) in BGR order.
+        mean (ndarray): Mean values of 3 channels.
+        std (ndarray): Std values of 3 channels.
+        to_rgb (bool): Whether to convert the image to RGB.
+        flip (bool): Whether to flip the image horizontally.
+        size_divisor (int, optional): Pad the image so that its height and
+            width are multiples of this value.
+
+    Returns:
+        tuple: (img, pad_shape), the float32 image of shape (3, h', w') and
+            its padded shape in (h', w', 3).
+    """
+    h, w = img.shape[:2]
+    if size_divisor is not None:
+        pad_h = int(np.ceil(h / size_divisor)) * size_divisor
+        pad_w = int(np.ceil(w / size_divisor)) * size_divisor
+    else:
+        pad_h, pad_w = h, w
+    output = torch.empty((3, pad_h, pad_w), dtype=torch.float32)
+    img_transform_cpu.normalize_pad(
+        torch.from_numpy(np.ascontiguousarray(img)),
+        torch.from_numpy(np.asarray(mean, dtype=np.float32)),
+        torch.from_numpy(np.asarray(std, dtype=np.float32)), to_rgb, flip,
+        output)
+    return output.numpy(), (pad_h, pad_w, 3)
@@ -0,0 +1,12 @@
+from setuptools import setup
+from torch.utils.cpp_extension import BuildExtension, CppExtension
+
+setup(
+    name='img_transform_cpu',
+    ext_modules=[
+        CppExtension(
+            'img_transform_cpu', ['src/img_transform_cpu.cpp'],
+            extra_compile_args=['-O3', '-fopenmp'],
+            extra_link_args=['-fopenmp']),
+    ],
+    cmdclass={'build_ext': BuildExtension})
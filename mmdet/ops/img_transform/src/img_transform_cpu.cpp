@@ -0,0 +1,101 @@
+#include <torch/torch.h>
+#include <ATen/Parallel.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#define CHECK_CPU(x) AT_CHECK(!x.type().is_cuda(), #x, " must be a CPU tensor ")
+#define CHECK_CONTIGUOUS(x) \
+  AT_CHECK(x.is_contiguous(), #x, " must be contiguous ")
+#define CHECK_INPUT(x) \
+  CHECK_CPU(x);        \
+  CHECK_CONTIGUOUS(x)
+
+// Normalize, flip, pad and transpose one row of an HWC uint8 image into the
+// three planes of a CHW float image. The row is first deinterleaved (and
+// flipped) into three contiguous float rows, so that the normalization is a
+// unit stride loop the compiler vectorizes. The arithmetic is kept as
+// (x - mean) / std in float, a vectorized division is exact too, so the
+// result is bitwise identical to mmcv.imnormalize.
+static inline void normalize_row(const uint8_t *src, const int width,
+                                 const int src_c[3], const float mean[3],
+                                 const float std[3], const bool flip,
+                                 const int pad_width, float *buf, float *dst0,
+                                 float *dst1, float *dst2) {
+  float *rows[3] = {buf, buf + width, buf + 2 * width};
+  for (int x = 0; x < width; x++) {
+    const uint8_t *s = src + (flip ? width - 1 - x : x) * 3;
+    rows[0][x] = s[src_c[0]];
+    rows[1][x] = s[src_c[1]];
+    rows[2][x] = s[src_c[2]];
+  }
+  float *dst[3] = {dst0, dst1, dst2};
+  for (int c = 0; c < 3; c++) {
+    const float *__restrict__ r = rows[c];
+    float *__restrict__ d = dst[c];
+    const float m = mean[c], v = std[c];
+    for (int x = 0; x < width; x++) {
+      d[x] = (r[x] - m) / v;
+    }
+    std::fill(d + width, d + pad_width, 0.f);
+  }
+}
+
+// img: (h, w, 3) uint8 BGR image (already resized)
+// output: (3, pad_h, pad_w) float, rows and columns beyond (h, w) are zeros
+// Rows are split with at::parallel_for, so torch.set_num_threads applies
+// (dataloader workers run it with a single thread).
+int normalize_pad_forward(at::Tensor img, at::Tensor mean, at::Tensor std,
+                          bool to_rgb, bool flip, at::Tensor output) {
+  CHECK_INPUT(img);
+  CHECK_INPUT(output);
+  AT_CHECK(img.dim() == 3 && img.size(2) == 3,
+           "img must be of shape (h, w, 3)");
+  AT_CHECK(img.scalar_type() == at::kByte, "img must be a uint8 tensor");
+  AT_CHECK(output.scalar_type() == at::kFloat,
+           "output must be a float tensor");
+  AT_CHECK(mean.numel() == 3 && std.numel() == 3,
+           "mean and std must have 3 elements");
+
+  const int height = img.size(0);
+  const int width = img.size(1);
+  const int pad_height = output.size(1);
+  const int pad_width = output.size(2);
+  AT_CHECK(output.size(0) == 3 && pad_height >= height && pad_width >= width,
+           "output must be of shape (3, pad_h, pad_w) covering the image");
+
+  at::Tensor mean_f = mean.to(at::kFloat).contiguous();
+  at::Tensor std_f = std.to(at::kFloat).contiguous();
+  float mean_v[3], std_v[3];
+  std::memcpy(mean_v, mean_f.data<float>(), sizeof(mean_v));
+  std::memcpy(std_v, std_f.data<float>(), sizeof(std_v));
+  // mean and std are given in the output channel order
+  const int src_c[3] = {to_rgb ? 2 : 0, 1, to_rgb ? 0 : 2};
+
+  const uint8_t *src = img.data<uint8_t>();
+  float *dst = output.data<float>();
+  const int64_t plane = static_cast<int64_t>(pad_height) * pad_width;
+
+  at::parallel_for(0, pad_height, 16, [&](int64_t begin, int64_t end) {
+    std::vector<float> buf(3 * width);
+    for (int64_t y = begin; y < end; y++) {
+      float *d0 = dst + y * pad_width;
+      if (y < height) {
+        normalize_row(src + y * width * 3, width, src_c, mean_v, std_v, flip,
+                      pad_width, buf.data(), d0, d0 + plane, d0 + 2 * plane);
+      } else {
+        for (int c = 0; c < 3; c++) {
+          std::fill(d0 + c * plane, d0 + c * plane + pad_width, 0.f);
+        }
+      }
+    }
+  });
+  return 1;
+}
+
+PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
+  m.def("normalize_pad", &normalize_pad_forward,
+        "fused normalize, flip, pad and transpose of an image (CPU)",
+        py::call_guard<py::gil_scoped_release>());
+}
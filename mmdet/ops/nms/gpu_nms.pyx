@@ -11,13 +11,13 @@ cimport numpy as np
 assert sizeof(int) == sizeof(np.int32_t)
 
 cdef extern from "gpu_nms.hpp":
-    void _nms(np.int32_t*, int*, np.float32_t*, int, int, float, int, size_t) nogil
+    void _nms(np.int32_t*, int*, np.float32_t*, int, int, float, int, size_t, int) nogil
     size_t nms_Malloc() nogil
 
 memory_pool = {}
 
 def gpu_nms(np.ndarray[np.float32_t, ndim=2] dets, np.float thresh,
-            np.int32_t device_id=0):
+            np.int32_t device_id=0, int multiplier=16):
     cdef int boxes_num = dets.shape[0]
     cdef int boxes_dim = 5
     cdef int num_out
@@ -31,6 +31,9 @@ def gpu_nms(np.ndarray[np.float32_t, ndim=2] dets, np.float thresh,
     cdef np.ndarray[np.float32_t, ndim=2] \
         sorted_dets = dets[order, :5]
     cdef float cthresh = thresh
+    if multiplier not in (1, 2, 4, 8, 16):
+        raise ValueError(
+            'unsupported nms multiplier {}'.format(multiplier))
     if device_id not in memory_pool:
         with nogil:
             base = nms_Malloc()
@@ -38,6 +41,6 @@ def gpu_nms(np.ndarray[np.float32_t, ndim=2] dets, np.float thresh,
         # print "malloc", base
     base = memory_pool[device_id]
     with nogil:
-        _nms(&keep[0], &num_out, &sorted_dets[0, 0], boxes_num, boxes_dim, cthresh, device_id, base)
+        _nms(&keep[0], &num_out, &sorted_dets[0, 0], boxes_num, boxes_dim, cthresh, device_id, base, multiplier)
     keep = keep[:num_out]
     return list(order[keep])
@@ -20,12 +20,7 @@
     } while (0)
 
 #define DIVUP(m, n) ((m) / (n) + ((m) % (n) > 0))
-#define MULTIPLIER 16
-#define LONGLONG_SIZE 64
-
-int const threadsPerBlock =
-    sizeof(unsigned long long) * 8 *
-    MULTIPLIER;  // number of bits for a long long variable
+#define LONGLONG_SIZE 64  // number of bits for a long long variable
 
 __device__ inline float devIoU(float const* const a, float const* const b) {
     float left = max(a[0], b[0]), right = min(a[2], b[2]);
@@ -38,9 +33,14 @@ __device__ inline float devIoU(float const* const a, float const* const b) {
     return interS / (Sa + Sb - interS);
 }
 
+// Each block compares LONGLONG_SIZE * MULTIPLIER boxes with as many others,
+// MULTIPLIER trades the number of blocks against their size and is tuned per
+// number of boxes (see mmdet/ops/autotune.py).
+template <int MULTIPLIER>
 __global__ void nms_kernel(const int n_boxes, const float nms_overlap_thresh,
                            const float* dev_boxes,
                            unsigned long long* dev_mask) {
+    const int threadsPerBlock = LONGLONG_SIZE * MULTIPLIER;
     const int row_start = blockIdx.y;
     const int col_start = blockIdx.x;
 
@@ -114,9 +114,13 @@ size_t nms_Malloc() {
 }
 
 void _nms(int* keep_out, int* num_out, const float* boxes_host, int boxes_num,
-          int boxes_dim, float nms_overlap_thresh, int device_id, size_t base) {
+          int boxes_dim, float nms_overlap_thresh, int device_id, size_t base,
+          int multiplier) {
     _set_device(device_id);
 
+    // multiplier is one of 1, 2, 4, 8 and 16, checked by gpu_nms
+    const int threadsPerBlock = LONGLONG_SIZE * multiplier;
+
     float* boxes_dev = NULL;
     unsigned long long* mask_dev = NULL;
 
@@ -125,7 +129,7 @@ void _nms(int* keep_out, int* num_out, const float* boxes_host, int boxes_num,
     if (base > 0) {
         size_t require_mem =
             boxes_num * boxes_dim * sizeof(float) +
-            boxes_num * col_blocks * sizeof(unsigned long long) * MULTIPLIER;
+            boxes_num * col_blocks * sizeof(unsigned long long) * multiplier;
         if (require_mem >= MEMORY_SIZE) {
             std::cout << "require_mem: " << require_mem << std::endl;
         }
@@ -140,7 +144,7 @@ void _nms(int* keep_out, int* num_out, const float* boxes_host, int boxes_num,
     } else {
         CUDA_CHECK(
             cudaMalloc(&boxes_dev, boxes_num * boxes_dim * sizeof(float)));
-        CUDA_CHECK(cudaMalloc(&mask_dev, MULTIPLIER * boxes_num * col_blocks *
+        CUDA_CHECK(cudaMalloc(&mask_dev, multiplier * boxes_num * col_blocks *
                                              sizeof(unsigned long long)));
     }
     CUDA_CHECK(cudaMemcpy(boxes_dev, boxes_host,
@@ -150,18 +154,37 @@ void _nms(int* keep_out, int* num_out, const float* boxes_host, int boxes_num,
     dim3 blocks(DIVUP(boxes_num, threadsPerBlock),
                 DIVUP(boxes_num, threadsPerBlock));
     dim3 threads(threadsPerBlock);
-    nms_kernel<<<blocks, threads>>>(boxes_num, nms_overlap_thresh, boxes_dev,
-                                    mask_dev);
+    switch (multiplier) {
+        case 1:
+            nms_kernel<1><<<blocks, threads>>>(boxes_num, nms_overlap_thresh,
+                                               boxes_dev, mask_dev);
+            break;
+        case 2:
+            nms_kernel<2><<<blocks, threads>>>(boxes_num, nms_overlap_thresh,
+                                               boxes_dev, mask_dev);
+            break;
+        case 4:
+            nms_kernel<4><<<blocks, threads>>>(boxes_num, nms_overlap_thresh,
+                                               boxes_dev, mask_dev);
+            break;
+        case 8:
+            nms_kernel<8><<<blocks, threads>>>(boxes_num, nms_overlap_thresh,
+                                               boxes_dev, mask_dev);
+            break;
+        case 16:
+            nms_kernel<16><<<blocks, threads>>>(boxes_num, nms_overlap_thresh,
+                                                boxes_dev, mask_dev);
+    }
 
     std::vector<unsigned long long> mask_host(boxes_num * col_blocks *
-                                              MULTIPLIER);
+                                              multiplier);
     CUDA_CHECK(cudaMemcpy(
         &mask_host[0], mask_dev,
-        sizeof(unsigned long long) * boxes_num * col_blocks * MULTIPLIER,
+        sizeof(unsigned long long) * boxes_num * col_blocks * multiplier,
         cudaMemcpyDeviceToHost));
 
-    std::vector<unsigned long long> remv(col_blocks * MULTIPLIER);
-    memset(&remv[0], 0, sizeof(unsigned long long) * col_blocks * MULTIPLIER);
+    std::vector<unsigned long long> remv(col_blocks * multiplier);
+    memset(&remv[0], 0, sizeof(unsigned long long) * col_blocks * multiplier);
 
     int num_to_keep = 0;
     for (int i = 0; i < boxes_num; i++) {
@@ -170,11 +193,11 @@ void _nms(int* keep_out, int* num_out, const float* boxes_host, int boxes_num,
         int offset = inblock / LONGLONG_SIZE;
         int bit_pos = inblock % LONGLONG_SIZE;
 
-        if (!(remv[nblock * MULTIPLIER + offset] & (1ULL << bit_pos))) {
+        if (!(remv[nblock * multiplier + offset] & (1ULL << bit_pos))) {
             keep_out[num_to_keep++] = i;
-            unsigned long long* p = &mask_host[0] + i * col_blocks * MULTIPLIER;
-            for (int j = nblock * MULTIPLIER + offset;
-                 j < col_blocks * MULTIPLIER; j++) {
+            unsigned long long* p = &mask_host[0] + i * col_blocks * multiplier;
+            for (int j = nblock * multiplier + offset;
+                 j < col_blocks * multiplier; j++) {
                 remv[j] |= p[j];
             }
         }
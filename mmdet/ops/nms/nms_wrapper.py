@@ -4,6 +4,23 @@ import torch
 from .gpu_nms import gpu_nms
 from .cpu_nms import cpu_nms
 from .cpu_soft_nms import cpu_soft_nms
+from mmdet.ops.autotune import autotuner, cuda_device_name, shape_bucket
+
+# boxes handled by a block of the GPU kernel in units of 64, the first one is
+# the default
+GPU_NMS_MULTIPLIERS = (16, 8, 4, 2, 1)
+
+
+def _tuned_gpu_nms(dets_np, iou_thr, device_id):
+    key = None
+    if autotuner.active:
+        key = '{}|{}'.format(
+            cuda_device_name(device_id), shape_bucket(dets_np.shape[:1])[0])
+    # timed with the host to device copy and the final suppression on the
+    # host, which is what the caller waits for
+    return autotuner.run(
+        'gpu_nms', key, 'multiplier', GPU_NMS_MULTIPLIERS,
+        lambda m: gpu_nms(dets_np, iou_thr, device_id=device_id, multiplier=m))
 
 
 def nms(dets, iou_thr, device_id=None):
@@ -24,7 +41,7 @@ def nms(dets, iou_thr, device_id=None):
     if dets_np.shape[0] == 0:
         inds = []
     else:
-        inds = (gpu_nms(dets_np, iou_thr, device_id=device_id)
+        inds = (_tuned_gpu_nms(dets_np, iou_thr, device_id)
                 if device_id is not None else cpu_nms(dets_np, iou_thr))
 
     if is_tensor:
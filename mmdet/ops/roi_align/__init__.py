@@ -1,4 +1,4 @@
-from .functions.roi_align import roi_align
-from .modules.roi_align import RoIAlign
+from .functions.roi_align import roi_align, roi_align_quantized
+from .modules.roi_align import QuantizedRoIAlign, RoIAlign
 
-__all__ = ['roi_align', 'RoIAlign']
+__all__ = ['roi_align', 'RoIAlign', 'roi_align_quantized', 'QuantizedRoIAlign']
@@ -0,0 +1,83 @@
+import time
+
+import numpy as np
+import torch
+
+from mmdet.ops import DeformRoIPooling, RoIAlign, RoIPool
+
+# benchmark of roi reordering on a typical FPN level (stride 4, 1333x800)
+num_imgs = 2
+num_channels = 256
+feat_h, feat_w = 200, 336
+spatial_scale = 1.0 / 4
+num_iters = 20
+
+
+def random_rois(num_rois):
+    batch_ind = np.random.randint(num_imgs, size=(num_rois, 1))
+    wh = np.exp(np.random.uniform(np.log(8), np.log(400), size=(num_rois, 2)))
+    x1 = np.random.rand(num_rois, 1) * (feat_w / spatial_scale - wh[:, :1])
+    y1 = np.random.rand(num_rois, 1) * (feat_h / spatial_scale - wh[:, 1:])
+    return np.hstack((batch_ind, x1, y1, x1 + wh[:, :1], y1 + wh[:, 1:]))
+
+
+def run(layer, feat, rois, backward):
+    if feat.is_cuda:
+        torch.cuda.synchronize()
+    start = time.time()
+    for _ in range(num_iters):
+        out = layer(feat, rois)
+        if backward:
+            out.sum().backward()
+    if feat.is_cuda:
+        torch.cuda.synchronize()
+    return (time.time() - start) / num_iters * 1000, out
+
+
+def benchmark(name, build_layer, device, num_rois, backward):
+    feat = torch.randn(
+        num_imgs,
+        num_channels,
+        feat_h,
+        feat_w,
+        device=device,
+        requires_grad=backward)
+    rois = torch.from_numpy(random_rois(num_rois)).float().to(device)
+    results = []
+    for reorder in (False, True):
+        if feat.grad is not None:
+            feat.grad.zero_()
+        layer = build_layer(reorder)
+        run(layer, feat, rois, backward)  # warmup
+        elapsed, out = run(layer, feat, rois, backward)
+        grad = feat.grad.clone() if backward else None
+        results.append((elapsed, out, grad))
+    (t0, out0, grad0), (t1, out1, grad1) = results
+    same = torch.equal(out0, out1)
+    if backward:
+        same = same and torch.allclose(grad0, grad1, atol=1e-5)
+    print('{:<18} {:<4} {:>5} rois {:<8} {:8.2f} ms -> {:8.2f} ms '
+          '(same results: {})'.format(name, device, num_rois,
+                                      'fwd+bwd' if backward else 'fwd', t0,
+                                      t1, same))
+
+
+devices = ['cpu'] + (['cuda'] if torch.cuda.is_available() else [])
+for device in devices:
+    # 512 rois per training batch, 1000 rois per test image
+    for num_rois, backward in [(512, True), (1000, False)]:
+        benchmark('RoIAlign', lambda r: RoIAlign(
+            7, spatial_scale, 2, reorder=r), device, num_rois, backward)
+        benchmark('RoIAlign adaptive', lambda r: RoIAlign(
+            7, spatial_scale, 0, reorder=r), device, num_rois, backward)
+        if device == 'cuda':
+            benchmark('RoIPool', lambda r: RoIPool(
+                7, spatial_scale, reorder=r), device, num_rois, backward)
+
+            def deform_pool(r):
+                layer = DeformRoIPooling(
+                    spatial_scale, 7, num_channels, True, reorder=r)
+                return lambda feat, rois: layer(feat, rois, None)
+
+            benchmark('DeformRoIPooling', deform_pool, device, num_rois,
+                      backward)
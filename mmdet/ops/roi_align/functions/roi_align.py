@@ -1,12 +1,36 @@
-from torch.autograd import Function, Variable
+import torch
+from torch.autograd import Function
 
-from .. import roi_align_cuda
+from .. import roi_align_cpu, roi_align_cuda
+from mmdet.ops.autotune import CPU_CHANNELS_PER_ITEM, CUDA_THREADS, autotuner
+from ...roi_sort import sort_rois, unsort_rois
+
+
+def _tuned_run(op, features, num_rois, out_h, out_w, sample_num, fn):
+    """Call ``fn(launch)`` with the tuned launch parameter for these shapes,
+    the threads per block of the CUDA kernel or the channels per work item
+    of the CPU kernel."""
+    key = autotuner.make_key(
+        features, features.shape[1:], (num_rois, ),
+        out_size=(out_h, out_w),
+        sample_num=sample_num)
+    if features.is_cuda:
+        autotuner.run(op, key, 'threads', CUDA_THREADS, fn, True)
+    else:
+        autotuner.run(op, key, 'channels_per_item', CPU_CHANNELS_PER_ITEM, fn)
 
 
 class RoIAlignFunction(Function):
 
     @staticmethod
-    def forward(ctx, features, rois, out_size, spatial_scale, sample_num=0):
+    def forward(ctx,
+                features,
+                rois,
+                out_size,
+                spatial_scale,
+                sample_num=0,
+                reorder=False,
+                out_dtype=None):
         if isinstance(out_size, int):
             out_h = out_size
             out_w = out_size
@@ -20,20 +44,50 @@ class RoIAlignFunction(Function):
                 '"out_size" must be an integer or tuple of integers')
         ctx.spatial_scale = spatial_scale
         ctx.sample_num = sample_num
-        ctx.save_for_backward(rois)
         ctx.feature_size = features.size()
+        ctx.feature_dtype = features.dtype
+        if out_dtype is None:
+            out_dtype = features.dtype
+        if not features.is_cuda and features.dtype == torch.half:
+            # fp16 features are interpolated and accumulated in fp32, which
+            # is the dtype the CPU kernels expect rois in
+            rois = rois.float()
+        ctx.save_for_backward(rois)
 
         batch_size, num_channels, data_height, data_width = features.size()
         num_rois = rois.size(0)
 
-        output = features.new_zeros(num_rois, num_channels, out_h, out_w)
-        if features.is_cuda:
-            roi_align_cuda.forward(features, rois, out_h, out_w, spatial_scale,
-                                   sample_num, output)
+        # process rois in (batch index, spatial tile) order, which does not
+        # change the results but improves the cache hit rate. The CPU kernels
+        # start the most expensive rois first, but keep this order among
+        # rois whose costs round down to the same power of two
+        if reorder:
+            rois, ctx.order = sort_rois(rois, spatial_scale,
+                                        (data_height, data_width))
         else:
-            raise NotImplementedError
+            ctx.order = None
 
-        return output
+        # the kernels write outputs in the dtype of the features or of the
+        # rois, other dtypes are converted afterwards
+        output = features.new_zeros(
+            num_rois,
+            num_channels,
+            out_h,
+            out_w,
+            dtype=out_dtype if out_dtype == rois.dtype else features.dtype)
+        roi_align_ext = roi_align_cuda if features.is_cuda else roi_align_cpu
+
+        def run(launch):
+            # every output element is written, repeated runs are harmless
+            roi_align_ext.forward(features, rois, out_h, out_w, spatial_scale,
+                                  sample_num, output, launch)
+
+        _tuned_run('roi_align_forward', features, num_rois, out_h, out_w,
+                   sample_num, run)
+
+        if ctx.order is not None:
+            output = unsort_rois(output, ctx.order)
+        return output.to(out_dtype)
 
     @staticmethod
     def backward(ctx, grad_output):
@@ -41,7 +95,7 @@ class RoIAlignFunction(Function):
         spatial_scale = ctx.spatial_scale
         sample_num = ctx.sample_num
         rois = ctx.saved_tensors[0]
-        assert (feature_size is not None and grad_output.is_cuda)
+        assert feature_size is not None
 
         batch_size, num_channels, data_height, data_width = feature_size
         out_w = grad_output.size(3)
@@ -49,13 +103,83 @@ class RoIAlignFunction(Function):
 
         grad_input = grad_rois = None
         if ctx.needs_input_grad[0]:
-            grad_input = Variable(
-                rois.new(batch_size, num_channels, data_height, data_width)
-                .zero_())
-            roi_align_cuda.backward(grad_output, rois, out_h, out_w,
-                                    spatial_scale, sample_num, grad_input)
+            grad_input = grad_output.new_zeros(
+                batch_size,
+                num_channels,
+                data_height,
+                data_width,
+                dtype=ctx.feature_dtype)
+            if grad_output.dtype != rois.dtype:
+                grad_output = grad_output.to(ctx.feature_dtype)
+            if grad_output.is_cuda:
+                roi_align_ext = roi_align_cuda
+                if ctx.order is not None:
+                    rois = rois[ctx.order].contiguous()
+                    grad_output = grad_output[ctx.order]
+            else:
+                # the CPU backward already groups rois by image, keeping the
+                # original order inside an image keeps the summation order
+                # and thus the result unchanged
+                roi_align_ext = roi_align_cpu
+            grad_output = grad_output.contiguous()
+
+            def run(launch):
+                # the gradients are accumulated, start over on every run
+                grad_input.zero_()
+                roi_align_ext.backward(grad_output, rois, out_h, out_w,
+                                       spatial_scale, sample_num, grad_input,
+                                       launch)
 
-        return grad_input, grad_rois, None, None, None
+            _tuned_run('roi_align_backward', grad_input, rois.size(0), out_h,
+                       out_w, sample_num, run)
+
+        return grad_input, grad_rois, None, None, None, None, None
 
 
 roi_align = RoIAlignFunction.apply
+
+
+def roi_align_quantized(features,
+                        rois,
+                        out_size,
+                        spatial_scale,
+                        scale,
+                        zero_point,
+                        sample_num=0,
+                        out_scale=None,
+                        out_zero_point=0):
+    """RoIAlign of uint8/int8 CPU features (forward only).
+
+    The features represent ``scale * (features - zero_point)``, where
+    ``scale`` and ``zero_point`` are numbers or per-channel 1-D tensors. The
+    output is float if ``out_scale`` is None and otherwise requantized to the
+    dtype of the features with ``out_scale`` and ``out_zero_point``.
+    """
+    assert not features.is_cuda, 'quantized RoIAlign runs on the CPU only'
+    assert features.dtype in (torch.uint8, torch.int8)
+    if isinstance(out_size, int):
+        out_h = out_w = out_size
+    else:
+        out_h, out_w = out_size
+    scale = torch.as_tensor(scale, dtype=torch.float).view(-1).contiguous()
+    zero_point = torch.as_tensor(
+        zero_point, dtype=torch.int).view(-1).contiguous()
+    rois = rois.float().contiguous()
+
+    num_rois = rois.size(0)
+    output = features.new_empty(
+        num_rois,
+        features.size(1),
+        out_h,
+        out_w,
+        dtype=torch.float if out_scale is None else features.dtype)
+
+    def run(launch):
+        roi_align_cpu.forward_quantized(
+            features, rois, out_h, out_w, spatial_scale, sample_num, scale,
+            zero_point, 0. if out_scale is None else out_scale,
+            out_zero_point, output, launch)
+
+    _tuned_run('roi_align_quantized', features, num_rois, out_h, out_w,
+               sample_num, run)
+    return output
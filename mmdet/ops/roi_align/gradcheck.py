@@ -4,8 +4,9 @@ from torch.autograd import gradcheck
 
 import os.path as osp
 import sys
-sys.path.append(osp.abspath(osp.join(__file__, '../../')))
-from roi_align import RoIAlign  # noqa: E402
+# the ops import each other relatively, import them from the repository
+sys.path.append(osp.abspath(osp.join(__file__, '../../../../')))
+from mmdet.ops.roi_align import QuantizedRoIAlign, RoIAlign  # noqa: E402
 
 feat_size = 15
 spatial_scale = 1.0 / 8
@@ -18,12 +19,102 @@ rois = np.random.rand(num_rois, 4) * img_size * 0.5
 rois[:, 2:] += img_size * 0.5
 rois = np.hstack((batch_ind, rois))
 
-feat = torch.randn(
-    num_imgs, 16, feat_size, feat_size, requires_grad=True, device='cuda:0')
-rois = torch.from_numpy(rois).float().cuda()
-inputs = (feat, rois)
-print('Gradcheck for roi align...')
-test = gradcheck(RoIAlign(3, spatial_scale), inputs, atol=1e-3, eps=1e-3)
+feat = torch.randn(num_imgs, 16, feat_size, feat_size)
+rois = torch.from_numpy(rois).float()
+
+feat_cpu = feat.double().requires_grad_()
+rois_cpu = rois.double()
+print('Gradcheck for roi align (CPU)...')
+test = gradcheck(
+    RoIAlign(3, spatial_scale), (feat_cpu, rois_cpu), atol=1e-3, eps=1e-3)
 print(test)
-test = gradcheck(RoIAlign(3, spatial_scale, 2), inputs, atol=1e-3, eps=1e-3)
+test = gradcheck(
+    RoIAlign(3, spatial_scale, 2), (feat_cpu, rois_cpu), atol=1e-3, eps=1e-3)
 print(test)
+
+if torch.cuda.is_available():
+    inputs = (feat.cuda().requires_grad_(), rois.cuda())
+    print('Gradcheck for roi align...')
+    test = gradcheck(RoIAlign(3, spatial_scale), inputs, atol=1e-3, eps=1e-3)
+    print(test)
+    test = gradcheck(
+        RoIAlign(3, spatial_scale, 2), inputs, atol=1e-3, eps=1e-3)
+    print(test)
+
+
+def errors(output, ref):
+    """Max absolute and mean relative error against an fp64 reference."""
+    diff = (output.double() - ref).abs()
+    return diff.max().item(), (diff.sum() / ref.abs().sum()).item()
+
+
+def check_errors(name, output, ref, mean_rel, max_abs=None):
+    max_err, mean_rel_err = errors(output, ref)
+    print('{}: max abs err {:.3g}, mean rel err {:.3g}'.format(
+        name, max_err, mean_rel_err))
+    assert mean_rel_err < mean_rel, name
+    assert max_abs is None or max_err < max_abs, name
+
+
+# fp16 storage on the CPU is accumulated in fp32, check the errors of the
+# reduced precision table in TECHNICAL_DETAILS.md (at most twice the table
+# values for fp16 storage)
+print('Errors of roi align (CPU) against fp64...')
+shape = (2, 256, 200, 336)
+big_scale = 0.25
+sizes = np.exp(np.log(8) + np.random.rand(512, 2) * np.log(50))
+corners = np.random.rand(512, 2) * (
+    np.array([shape[3], shape[2]]) / big_scale - sizes)
+big_rois = torch.from_numpy(
+    np.hstack((np.arange(512)[:, None] % shape[0], corners,
+               corners + sizes))).double()
+big_feat = torch.randn(*shape, dtype=torch.double, requires_grad=True)
+feat_fp32 = big_feat.detach().float().requires_grad_()
+feat_fp16 = big_feat.detach().half().requires_grad_()
+grad = torch.randn(512, shape[1], 7, 7, dtype=torch.double)
+
+ref = RoIAlign(7, big_scale, 2)(big_feat, big_rois)
+out_fp32 = RoIAlign(7, big_scale, 2)(feat_fp32, big_rois.float())
+out_fp16 = RoIAlign(
+    7, big_scale, 2, out_dtype=torch.float)(feat_fp16, big_rois.float())
+check_errors('fwd fp32', out_fp32, ref, 1e-4)
+check_errors('fwd fp16 storage, fp32 out', out_fp16, ref, 4e-4, 2.4e-3)
+out_fp16_half = RoIAlign(7, big_scale, 2)(feat_fp16, big_rois.float())
+check_errors('fwd fp16 storage, fp16 out', out_fp16_half, ref, 5.4e-4, 4e-3)
+
+ref.backward(grad)
+out_fp32.backward(grad.float())
+out_fp16.backward(grad.float())
+check_errors('bwd fp32', feat_fp32.grad, big_feat.grad, 1e-4)
+check_errors('bwd fp16 storage', feat_fp16.grad, big_feat.grad, 3.6e-4, 4e-3)
+
+# uint8 features with a per-channel scale against the fp32 roi align of the
+# dequantized features, check the errors in TECHNICAL_DETAILS.md
+print('Errors of quantized roi align (CPU)...')
+big_rois = big_rois.float()
+scale = (torch.rand(shape[1]) * 0.02 + 0.02).view(1, -1, 1, 1)
+zero_point = torch.randint(0, 32, (shape[1], )).int().view(1, -1, 1, 1)
+feat_q = (big_feat.detach().float() / scale +
+          zero_point.float()).round().clamp(0, 255)
+feat_deq = (feat_q - zero_point.float()) * scale
+feat_q = feat_q.byte()
+scale, zero_point = scale.view(-1), zero_point.view(-1)
+out_scale, out_zero_point = 0.02, 10
+for out_size in (7, 14):
+    ref = RoIAlign(out_size, big_scale, 2)(feat_deq, big_rois)
+    out = QuantizedRoIAlign(out_size, big_scale, 2)(feat_q, big_rois, scale,
+                                                    zero_point)
+    name = 'uint8 {0}x{0}'.format(out_size)
+    check_errors(name + ' float out', out, ref.double(), 3e-4)
+    # the requantized output is the float output rounded to the nearest step
+    # of the output dtype
+    out_q = QuantizedRoIAlign(out_size, big_scale, 2, out_scale,
+                              out_zero_point)(feat_q, big_rois, scale,
+                                              zero_point)
+    out_deq = (out_q.float() - out_zero_point) * out_scale
+    rounded = out.clamp(-out_zero_point * out_scale,
+                        (255 - out_zero_point) * out_scale)
+    max_err = (out_deq - rounded).abs().max().item()
+    print('{} requantized out: max err {:.3g} steps'.format(
+        name, max_err / out_scale))
+    assert max_err <= out_scale * 0.5001, name
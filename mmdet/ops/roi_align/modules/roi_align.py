@@ -1,16 +1,49 @@
 from torch.nn.modules.module import Module
-from ..functions.roi_align import RoIAlignFunction
+from ..functions.roi_align import RoIAlignFunction, roi_align_quantized
 
 
 class RoIAlign(Module):
 
-    def __init__(self, out_size, spatial_scale, sample_num=0):
+    def __init__(self,
+                 out_size,
+                 spatial_scale,
+                 sample_num=0,
+                 reorder=False,
+                 out_dtype=None):
         super(RoIAlign, self).__init__()
 
         self.out_size = out_size
         self.spatial_scale = float(spatial_scale)
         self.sample_num = int(sample_num)
+        self.reorder = reorder
+        self.out_dtype = out_dtype
 
     def forward(self, features, rois):
         return RoIAlignFunction.apply(features, rois, self.out_size,
-                                      self.spatial_scale, self.sample_num)
+                                      self.spatial_scale, self.sample_num,
+                                      self.reorder, self.out_dtype)
+
+
+class QuantizedRoIAlign(Module):
+    """RoIAlign of uint8/int8 CPU features, see :func:`roi_align_quantized`.
+    """
+
+    def __init__(self,
+                 out_size,
+                 spatial_scale,
+                 sample_num=0,
+                 out_scale=None,
+                 out_zero_point=0):
+        super(QuantizedRoIAlign, self).__init__()
+
+        self.out_size = out_size
+        self.spatial_scale = float(spatial_scale)
+        self.sample_num = int(sample_num)
+        self.out_scale = out_scale
+        self.out_zero_point = int(out_zero_point)
+
+    def forward(self, features, rois, scale, zero_point):
+        return roi_align_quantized(features, rois, self.out_size,
+                                   self.spatial_scale, scale, zero_point,
+                                   self.sample_num, self.out_scale,
+                                   self.out_zero_point)
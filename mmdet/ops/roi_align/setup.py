@@ -1,5 +1,11 @@
+import os.path as osp
+
 from setuptools import setup
-from torch.utils.cpp_extension import BuildExtension, CUDAExtension
+from torch.utils.cpp_extension import (BuildExtension, CppExtension,
+                                       CUDAExtension)
+
+# cpu_utils.h, shared by the CPU implementations of the ops
+common_dir = osp.join(osp.dirname(osp.abspath(__file__)), '..', 'common')
 
 setup(
     name='roi_align_cuda',
@@ -8,5 +14,10 @@ setup(
             'src/roi_align_cuda.cpp',
             'src/roi_align_kernel.cu',
         ]),
+        CppExtension(
+            'roi_align_cpu', ['src/roi_align_cpu.cpp'],
+            include_dirs=[common_dir],
+            extra_compile_args=['-O3', '-fopenmp'],
+            extra_link_args=['-fopenmp']),
     ],
     cmdclass={'build_ext': BuildExtension})
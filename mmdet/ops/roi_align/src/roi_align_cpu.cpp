@@ -0,0 +1,631 @@
+#include <torch/torch.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "cpu_utils.h"
+
+#define CHECK_CPU(x) AT_CHECK(!x.type().is_cuda(), #x, " must be a CPU tensor ")
+#define CHECK_CONTIGUOUS(x) \
+  AT_CHECK(x.is_contiguous(), #x, " must be contiguous ")
+#define CHECK_INPUT(x) \
+  CHECK_CPU(x);        \
+  CHECK_CONTIGUOUS(x)
+
+template <typename scalar_t>
+struct RoIGeometry {
+  int batch_ind;
+  scalar_t start_h, start_w;
+  scalar_t bin_size_h, bin_size_w;
+  int sample_num_h, sample_num_w;
+};
+
+// Same arithmetic as ROIAlignForward in roi_align_kernel.cu
+template <typename scalar_t>
+std::vector<RoIGeometry<scalar_t>> get_roi_geometry(
+    const scalar_t *rois, const int num_rois, const scalar_t spatial_scale,
+    const int sample_num, const int pooled_height, const int pooled_width) {
+  std::vector<RoIGeometry<scalar_t>> geometry(num_rois);
+  for (int n = 0; n < num_rois; n++) {
+    const scalar_t *offset_rois = rois + n * 5;
+    RoIGeometry<scalar_t> &g = geometry[n];
+    g.batch_ind = offset_rois[0];
+    g.start_w = offset_rois[1] * spatial_scale;
+    g.start_h = offset_rois[2] * spatial_scale;
+    scalar_t end_w = (offset_rois[3] + 1) * spatial_scale;
+    scalar_t end_h = (offset_rois[4] + 1) * spatial_scale;
+
+    // Force malformed ROIs to be 1x1
+    scalar_t roi_width = std::max(end_w - g.start_w, (scalar_t)0.);
+    scalar_t roi_height = std::max(end_h - g.start_h, (scalar_t)0.);
+
+    g.bin_size_h = roi_height / pooled_height;
+    g.bin_size_w = roi_width / pooled_width;
+    g.sample_num_h =
+        (sample_num > 0) ? sample_num : std::ceil(roi_height / pooled_height);
+    g.sample_num_w =
+        (sample_num > 0) ? sample_num : std::ceil(roi_width / pooled_width);
+  }
+  return geometry;
+}
+
+template <typename scalar_t, typename acc_t>
+inline acc_t bilinear_interpolate(const scalar_t *bottom_data,
+                                  const int height, const int width, acc_t y,
+                                  acc_t x) {
+  // deal with cases that inverse elements are out of feature map boundary
+  if (y < -1.0 || y > height || x < -1.0 || x > width) {
+    return 0;
+  }
+
+  if (y <= 0) y = 0;
+  if (x <= 0) x = 0;
+
+  int y_low = (int)y;
+  int x_low = (int)x;
+  int y_high;
+  int x_high;
+
+  if (y_low >= height - 1) {
+    y_high = y_low = height - 1;
+    y = (acc_t)y_low;
+  } else {
+    y_high = y_low + 1;
+  }
+
+  if (x_low >= width - 1) {
+    x_high = x_low = width - 1;
+    x = (acc_t)x_low;
+  } else {
+    x_high = x_low + 1;
+  }
+
+  acc_t ly = y - y_low;
+  acc_t lx = x - x_low;
+  acc_t hy = 1. - ly;
+  acc_t hx = 1. - lx;
+  // do bilinear interpolation
+  acc_t lt = bottom_data[y_low * width + x_low];
+  acc_t rt = bottom_data[y_low * width + x_high];
+  acc_t lb = bottom_data[y_high * width + x_low];
+  acc_t rb = bottom_data[y_high * width + x_high];
+  acc_t w1 = hy * hx, w2 = hy * lx, w3 = ly * hx, w4 = ly * lx;
+
+  return w1 * lt + w2 * rt + w3 * lb + w4 * rb;
+}
+
+template <typename scalar_t>
+inline void bilinear_interpolate_gradient(const int height, const int width,
+                                          scalar_t y, scalar_t x,
+                                          scalar_t &w1, scalar_t &w2,
+                                          scalar_t &w3, scalar_t &w4,
+                                          int &x_low, int &x_high, int &y_low,
+                                          int &y_high) {
+  // deal with cases that inverse elements are out of feature map boundary
+  if (y < -1.0 || y > height || x < -1.0 || x > width) {
+    w1 = w2 = w3 = w4 = 0.;
+    x_low = x_high = y_low = y_high = -1;
+    return;
+  }
+
+  if (y <= 0) y = 0;
+  if (x <= 0) x = 0;
+
+  y_low = (int)y;
+  x_low = (int)x;
+
+  if (y_low >= height - 1) {
+    y_high = y_low = height - 1;
+    y = (scalar_t)y_low;
+  } else {
+    y_high = y_low + 1;
+  }
+
+  if (x_low >= width - 1) {
+    x_high = x_low = width - 1;
+    x = (scalar_t)x_low;
+  } else {
+    x_high = x_low + 1;
+  }
+
+  scalar_t ly = y - y_low;
+  scalar_t lx = x - x_low;
+  scalar_t hy = 1. - ly;
+  scalar_t hx = 1. - lx;
+
+  w1 = hy * hx, w2 = hy * lx, w3 = ly * hx, w4 = ly * lx;
+}
+
+template <typename scalar_t, typename out_t, typename acc_t>
+void ROIAlignForwardCPU(const scalar_t *bottom_data,
+                        const RoIGeometry<acc_t> &g, const int c_start,
+                        const int c_end, const int channels, const int height,
+                        const int width, const int pooled_height,
+                        const int pooled_width, out_t *top_data) {
+  const acc_t count = (acc_t)(g.sample_num_h * g.sample_num_w);
+  for (int c = c_start; c < c_end; c++) {
+    const scalar_t *offset_bottom_data =
+        bottom_data + (g.batch_ind * channels + c) * height * width;
+    out_t *offset_top_data = top_data + c * pooled_height * pooled_width;
+    for (int ph = 0; ph < pooled_height; ph++) {
+      for (int pw = 0; pw < pooled_width; pw++) {
+        acc_t output_val = 0;
+        for (int iy = 0; iy < g.sample_num_h; iy++) {
+          const acc_t y = g.start_h + ph * g.bin_size_h +
+                          (acc_t)(iy + acc_t(.5f)) * g.bin_size_h /
+                              (acc_t)(g.sample_num_h);
+          for (int ix = 0; ix < g.sample_num_w; ix++) {
+            const acc_t x = g.start_w + pw * g.bin_size_w +
+                            (acc_t)(ix + acc_t(.5f)) * g.bin_size_w /
+                                (acc_t)(g.sample_num_w);
+            output_val += bilinear_interpolate<scalar_t, acc_t>(
+                offset_bottom_data, height, width, y, x);
+          }
+        }
+        offset_top_data[ph * pooled_width + pw] =
+            static_cast<out_t>(output_val / count);
+      }
+    }
+  }
+}
+
+// bottom_diff points to channel c_start of the image of the roi
+template <typename out_t, typename acc_t>
+void ROIAlignBackwardCPU(const out_t *top_diff, const RoIGeometry<acc_t> &g,
+                         const int c_start, const int c_end, const int height,
+                         const int width, const int pooled_height,
+                         const int pooled_width, acc_t *bottom_diff) {
+  const acc_t count = (acc_t)(g.sample_num_h * g.sample_num_w);
+  for (int c = c_start; c < c_end; c++) {
+    acc_t *offset_bottom_diff = bottom_diff + (c - c_start) * height * width;
+    const out_t *offset_top_diff =
+        top_diff + c * pooled_height * pooled_width;
+    for (int ph = 0; ph < pooled_height; ph++) {
+      for (int pw = 0; pw < pooled_width; pw++) {
+        const acc_t top = offset_top_diff[ph * pooled_width + pw];
+        for (int iy = 0; iy < g.sample_num_h; iy++) {
+          const acc_t y = g.start_h + ph * g.bin_size_h +
+                          (acc_t)(iy + .5f) * g.bin_size_h /
+                              (acc_t)(g.sample_num_h);
+          for (int ix = 0; ix < g.sample_num_w; ix++) {
+            const acc_t x = g.start_w + pw * g.bin_size_w +
+                            (acc_t)(ix + .5f) * g.bin_size_w /
+                                (acc_t)(g.sample_num_w);
+            acc_t w1, w2, w3, w4;
+            int x_low, x_high, y_low, y_high;
+            bilinear_interpolate_gradient<acc_t>(height, width, y, x, w1, w2,
+                                                 w3, w4, x_low, x_high, y_low,
+                                                 y_high);
+            if (x_low >= 0 && x_high >= 0 && y_low >= 0 && y_high >= 0) {
+              offset_bottom_diff[y_low * width + x_low] += top * w1 / count;
+              offset_bottom_diff[y_low * width + x_high] += top * w2 / count;
+              offset_bottom_diff[y_high * width + x_low] += top * w3 / count;
+              offset_bottom_diff[y_high * width + x_high] += top * w4 / count;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// Estimated cost of one output channel of a roi
+template <typename scalar_t>
+inline int64_t roi_cost(const RoIGeometry<scalar_t> &g,
+                        const int pooled_height, const int pooled_width) {
+  return static_cast<int64_t>(pooled_height) * pooled_width *
+         std::max(g.sample_num_h * g.sample_num_w, 1);
+}
+
+template <typename scalar_t, typename out_t>
+void ROIAlignForwardLauncherCPU(const at::Tensor features,
+                                const at::Tensor rois, const int num_rois,
+                                const int channels, const int height,
+                                const int width, const int pooled_height,
+                                const int pooled_width,
+                                const float spatial_scale,
+                                const int sample_num,
+                                const int channels_per_item,
+                                at::Tensor output) {
+  typedef typename acc_type<scalar_t>::type acc_t;
+  const int num_blocks = (channels + channels_per_item - 1) / channels_per_item;
+  const scalar_t *bottom_data = features.data<scalar_t>();
+  out_t *top_data = output.data<out_t>();
+  const auto geometry = get_roi_geometry<acc_t>(
+      rois.data<acc_t>(), num_rois, acc_t(spatial_scale), sample_num,
+      pooled_height, pooled_width);
+
+  // one work item per (roi, block of channels)
+  std::vector<int64_t> cost(static_cast<int64_t>(num_rois) * num_blocks);
+  for (int n = 0; n < num_rois; n++) {
+    std::fill(cost.begin() + n * num_blocks,
+              cost.begin() + (n + 1) * num_blocks,
+              roi_cost(geometry[n], pooled_height, pooled_width));
+  }
+  parallel_for_cost(cost, [&](int64_t item) {
+    const int n = item / num_blocks;
+    const int c_start = (item % num_blocks) * channels_per_item;
+    const int c_end = std::min(c_start + channels_per_item, channels);
+    ROIAlignForwardCPU<scalar_t, out_t, acc_t>(
+        bottom_data, geometry[n], c_start, c_end, channels, height, width,
+        pooled_height, pooled_width,
+        top_data + n * channels * pooled_height * pooled_width);
+  });
+}
+
+template <typename scalar_t, typename out_t>
+void ROIAlignBackwardLauncherCPU(const at::Tensor top_grad,
+                                 const at::Tensor rois, const int num_rois,
+                                 const int batch_size, const int channels,
+                                 const int height, const int width,
+                                 const int pooled_height,
+                                 const int pooled_width,
+                                 const float spatial_scale,
+                                 const int sample_num,
+                                 const int channels_per_item,
+                                 at::Tensor bottom_grad) {
+  typedef typename acc_type<scalar_t>::type acc_t;
+  const int num_blocks = (channels + channels_per_item - 1) / channels_per_item;
+  const out_t *top_diff = top_grad.data<out_t>();
+  scalar_t *bottom_diff = bottom_grad.data<scalar_t>();
+  const auto geometry = get_roi_geometry<acc_t>(
+      rois.data<acc_t>(), num_rois, acc_t(spatial_scale), sample_num,
+      pooled_height, pooled_width);
+
+  // One work item per (image, block of channels), which scatters the
+  // gradients of all rois of that image. Items never write to the same
+  // location, so no atomics are needed and the result is deterministic.
+  std::vector<std::vector<int>> rois_per_image(batch_size);
+  std::vector<int64_t> cost(static_cast<int64_t>(batch_size) * num_blocks, 0);
+  for (int n = 0; n < num_rois; n++) {
+    const int b = geometry[n].batch_ind;
+    AT_CHECK(b >= 0 && b < batch_size, "invalid batch index of roi ", n);
+    rois_per_image[b].push_back(n);
+    const int64_t c = roi_cost(geometry[n], pooled_height, pooled_width);
+    for (int k = 0; k < num_blocks; k++) cost[b * num_blocks + k] += c;
+  }
+  parallel_for_cost(cost, [&](int64_t item) {
+    const int b = item / num_blocks;
+    const int c_start = (item % num_blocks) * channels_per_item;
+    const int c_end = std::min(c_start + channels_per_item, channels);
+    Accumulator<scalar_t, acc_t> accumulator;
+    acc_t *acc_diff = accumulator.begin(
+        bottom_diff + (b * channels + c_start) * height * width,
+        (c_end - c_start) * height * width);
+    for (const int n : rois_per_image[b]) {
+      ROIAlignBackwardCPU<out_t, acc_t>(
+          top_diff + n * channels * pooled_height * pooled_width,
+          geometry[n], c_start, c_end, height, width, pooled_height,
+          pooled_width, acc_diff);
+    }
+    accumulator.end();
+  });
+}
+
+int roi_align_forward_cpu(at::Tensor features, at::Tensor rois,
+                          int pooled_height, int pooled_width,
+                          float spatial_scale, int sample_num,
+                          at::Tensor output, int channels_per_item) {
+  CHECK_INPUT(features);
+  CHECK_INPUT(rois);
+  CHECK_INPUT(output);
+  check_types(features, rois, output);
+
+  // Number of ROIs
+  int num_rois = rois.size(0);
+  int size_rois = rois.size(1);
+
+  if (size_rois != 5) {
+    printf("wrong roi size\n");
+    return 0;
+  }
+
+  int channels = features.size(1);
+  int height = features.size(2);
+  int width = features.size(3);
+  // number of channels processed by a single work item
+  AT_CHECK(channels_per_item > 0, "channels_per_item must be positive");
+
+  const bool out_acc =
+      output.type().scalarType() != features.type().scalarType();
+  AT_DISPATCH_FLOATING_TYPES_AND_HALF(
+      features.type(), "ROIAlignForwardCPU", ([&] {
+        typedef typename acc_type<scalar_t>::type acc_t;
+        if (out_acc) {
+          ROIAlignForwardLauncherCPU<scalar_t, acc_t>(
+              features, rois, num_rois, channels, height, width,
+              pooled_height, pooled_width, spatial_scale, sample_num,
+              channels_per_item, output);
+        } else {
+          ROIAlignForwardLauncherCPU<scalar_t, scalar_t>(
+              features, rois, num_rois, channels, height, width,
+              pooled_height, pooled_width, spatial_scale, sample_num,
+              channels_per_item, output);
+        }
+      }));
+
+  return 1;
+}
+
+int roi_align_backward_cpu(at::Tensor top_grad, at::Tensor rois,
+                           int pooled_height, int pooled_width,
+                           float spatial_scale, int sample_num,
+                           at::Tensor bottom_grad, int channels_per_item) {
+  CHECK_INPUT(top_grad);
+  CHECK_INPUT(rois);
+  CHECK_INPUT(bottom_grad);
+  check_types(bottom_grad, rois, top_grad);
+
+  // Number of ROIs
+  int num_rois = rois.size(0);
+  int size_rois = rois.size(1);
+  if (size_rois != 5) {
+    printf("wrong roi size\n");
+    return 0;
+  }
+
+  int batch_size = bottom_grad.size(0);
+  int channels = bottom_grad.size(1);
+  int height = bottom_grad.size(2);
+  int width = bottom_grad.size(3);
+  // number of channels processed by a single work item
+  AT_CHECK(channels_per_item > 0, "channels_per_item must be positive");
+
+  const bool out_acc =
+      top_grad.type().scalarType() != bottom_grad.type().scalarType();
+  AT_DISPATCH_FLOATING_TYPES_AND_HALF(
+      bottom_grad.type(), "ROIAlignBackwardCPU", ([&] {
+        typedef typename acc_type<scalar_t>::type acc_t;
+        if (out_acc) {
+          ROIAlignBackwardLauncherCPU<scalar_t, acc_t>(
+              top_grad, rois, num_rois, batch_size, channels, height, width,
+              pooled_height, pooled_width, spatial_scale, sample_num,
+              channels_per_item, bottom_grad);
+        } else {
+          ROIAlignBackwardLauncherCPU<scalar_t, scalar_t>(
+              top_grad, rois, num_rois, batch_size, channels, height, width,
+              pooled_height, pooled_width, spatial_scale, sample_num,
+              channels_per_item, bottom_grad);
+        }
+      }));
+
+  return 1;
+}
+
+// Quantized forward: the features are uint8/int8 with a per-tensor or
+// per-channel scale and zero point, real = scale * (q - zero_point). Sampling
+// locations are computed once per roi as in ROIAlignForwardCPU and turned into
+// fixed point bilinear weights, which are products of two Q11 factors and sum
+// up to exactly 1 << 22 per sample. A sample then costs four integer
+// multiply-adds (at most 255 << 22 in magnitude, so int32 is enough), the
+// samples of a bin are summed in int64 and the zero point is subtracted once
+// per bin. The sum is scaled to real (or requantized) values on store.
+#define QUANT_WEIGHT_BITS 11
+
+struct QuantSample {
+  int pos[4];
+  int32_t weight[4];
+};
+
+// Fixed point samples of all bins of a roi, in bin order: the samples of bin
+// i are [bin_start[i], bin_start[i + 1]). Samples outside the feature map
+// interpolate to 0 and are dropped.
+void get_quant_samples(const RoIGeometry<float> &g, const int height,
+                       const int width, const int pooled_height,
+                       const int pooled_width,
+                       std::vector<QuantSample> &samples,
+                       std::vector<int> &bin_start) {
+  const int one = 1 << QUANT_WEIGHT_BITS;
+  samples.clear();
+  bin_start.assign(1, 0);
+  for (int ph = 0; ph < pooled_height; ph++) {
+    for (int pw = 0; pw < pooled_width; pw++) {
+      for (int iy = 0; iy < g.sample_num_h; iy++) {
+        float y = g.start_h + ph * g.bin_size_h +
+                  (float)(iy + float(.5f)) * g.bin_size_h /
+                      (float)(g.sample_num_h);
+        for (int ix = 0; ix < g.sample_num_w; ix++) {
+          float x = g.start_w + pw * g.bin_size_w +
+                    (float)(ix + float(.5f)) * g.bin_size_w /
+                        (float)(g.sample_num_w);
+          float w1, w2, w3, w4;
+          int x_low, x_high, y_low, y_high;
+          bilinear_interpolate_gradient<float>(height, width, y, x, w1, w2,
+                                               w3, w4, x_low, x_high, y_low,
+                                               y_high);
+          if (x_low < 0) continue;
+          // ly and lx are recovered from the weights to avoid repeating the
+          // clamping of bilinear_interpolate_gradient
+          const int ly = std::lrint((w3 + w4) * one);
+          const int lx = std::lrint((w2 + w4) * one);
+          QuantSample sample;
+          sample.pos[0] = y_low * width + x_low;
+          sample.pos[1] = y_low * width + x_high;
+          sample.pos[2] = y_high * width + x_low;
+          sample.pos[3] = y_high * width + x_high;
+          sample.weight[0] = (one - ly) * (one - lx);
+          sample.weight[1] = (one - ly) * lx;
+          sample.weight[2] = ly * (one - lx);
+          sample.weight[3] = ly * lx;
+          samples.push_back(sample);
+        }
+      }
+      bin_start.push_back(samples.size());
+    }
+  }
+}
+
+inline void store_output(const float val, const int zero_point, float *out) {
+  *out = val;
+}
+
+template <typename q_t>
+inline void store_output(const float val, const int zero_point, q_t *out) {
+  const long q = std::lrint(val) + zero_point;
+  *out = static_cast<q_t>(
+      std::min<long>(std::max<long>(q, std::numeric_limits<q_t>::min()),
+                     std::numeric_limits<q_t>::max()));
+}
+
+// out_scale is 0 for a float output
+template <typename q_t, typename out_t>
+void ROIAlignForwardQuantizedCPU(
+    const q_t *bottom_data, const RoIGeometry<float> &g,
+    const std::vector<QuantSample> &samples, const std::vector<int> &bin_start,
+    const float *scales, const int *zero_points, const bool per_channel,
+    const float out_scale, const int out_zero_point, const int c_start,
+    const int c_end, const int channels, const int height, const int width,
+    const int pooled_height, const int pooled_width, out_t *top_data) {
+  const int num_bins = pooled_height * pooled_width;
+  const int64_t count = static_cast<int64_t>(g.sample_num_h) * g.sample_num_w;
+  for (int c = c_start; c < c_end; c++) {
+    const q_t *offset_bottom_data =
+        bottom_data + (g.batch_ind * channels + c) * height * width;
+    out_t *offset_top_data = top_data + c * num_bins;
+    const int zero_point = zero_points[per_channel ? c : 0];
+    // real value of one unit of the bin sums, empty rois (count = 0) pool to 0
+    float multiplier = count > 0 ? scales[per_channel ? c : 0] /
+                                       std::ldexp(static_cast<float>(count),
+                                                  2 * QUANT_WEIGHT_BITS)
+                                 : 0.f;
+    if (out_scale > 0) multiplier /= out_scale;
+    for (int i = 0; i < num_bins; i++) {
+      int64_t sum = 0;
+      for (int s = bin_start[i]; s < bin_start[i + 1]; s++) {
+        const QuantSample &sample = samples[s];
+        sum += sample.weight[0] * offset_bottom_data[sample.pos[0]] +
+               sample.weight[1] * offset_bottom_data[sample.pos[1]] +
+               sample.weight[2] * offset_bottom_data[sample.pos[2]] +
+               sample.weight[3] * offset_bottom_data[sample.pos[3]];
+      }
+      sum -= static_cast<int64_t>(zero_point) *
+             (bin_start[i + 1] - bin_start[i]) *
+             (static_cast<int64_t>(1) << (2 * QUANT_WEIGHT_BITS));
+      store_output(multiplier * sum, out_zero_point, offset_top_data + i);
+    }
+  }
+}
+
+template <typename q_t, typename out_t>
+void ROIAlignForwardQuantizedLauncherCPU(
+    const at::Tensor features, const at::Tensor rois, const int num_rois,
+    const int channels, const int height, const int width,
+    const int pooled_height, const int pooled_width, const float spatial_scale,
+    const int sample_num, const at::Tensor scales,
+    const at::Tensor zero_points, const float out_scale,
+    const int out_zero_point, const int channels_per_item,
+    at::Tensor output) {
+  const int num_blocks = (channels + channels_per_item - 1) / channels_per_item;
+  const q_t *bottom_data = features.data<q_t>();
+  out_t *top_data = output.data<out_t>();
+  const float *scales_data = scales.data<float>();
+  const int *zero_points_data = zero_points.data<int>();
+  const bool per_channel = scales.size(0) > 1;
+  const auto geometry =
+      get_roi_geometry<float>(rois.data<float>(), num_rois, spatial_scale,
+                              sample_num, pooled_height, pooled_width);
+
+  // the fixed point samples of every roi, computed once and shared by all
+  // its channels
+  std::vector<std::vector<QuantSample> > samples(num_rois);
+  std::vector<std::vector<int> > bin_start(num_rois);
+#pragma omp parallel for schedule(dynamic)
+  for (int n = 0; n < num_rois; n++) {
+    get_quant_samples(geometry[n], height, width, pooled_height, pooled_width,
+                      samples[n], bin_start[n]);
+  }
+
+  // one work item per (roi, block of channels)
+  std::vector<int64_t> cost(static_cast<int64_t>(num_rois) * num_blocks);
+  for (int n = 0; n < num_rois; n++) {
+    std::fill(cost.begin() + n * num_blocks,
+              cost.begin() + (n + 1) * num_blocks,
+              roi_cost(geometry[n], pooled_height, pooled_width));
+  }
+  parallel_for_cost(cost, [&](int64_t item) {
+    const int n = item / num_blocks;
+    const int c_start = (item % num_blocks) * channels_per_item;
+    const int c_end = std::min(c_start + channels_per_item, channels);
+    ROIAlignForwardQuantizedCPU<q_t, out_t>(
+        bottom_data, geometry[n], samples[n], bin_start[n], scales_data,
+        zero_points_data, per_channel, out_scale, out_zero_point, c_start,
+        c_end, channels, height, width, pooled_height, pooled_width,
+        top_data + n * channels * pooled_height * pooled_width);
+  });
+}
+
+int roi_align_forward_quantized_cpu(at::Tensor features, at::Tensor rois,
+                                    int pooled_height, int pooled_width,
+                                    float spatial_scale, int sample_num,
+                                    at::Tensor scales, at::Tensor zero_points,
+                                    float out_scale, int out_zero_point,
+                                    at::Tensor output, int channels_per_item) {
+  CHECK_INPUT(features);
+  CHECK_INPUT(rois);
+  CHECK_INPUT(scales);
+  CHECK_INPUT(zero_points);
+  CHECK_INPUT(output);
+
+  const at::ScalarType type = features.type().scalarType();
+  AT_CHECK(type == at::kByte || type == at::kChar,
+           "features must be uint8 or int8");
+  AT_CHECK(rois.type().scalarType() == at::kFloat, "rois must be float");
+  AT_CHECK(scales.type().scalarType() == at::kFloat &&
+               zero_points.type().scalarType() == at::kInt,
+           "scales must be float and zero_points int");
+  // the output is float if out_scale is 0 and has the dtype of the features
+  // otherwise
+  AT_CHECK(output.type().scalarType() == (out_scale > 0 ? type : at::kFloat),
+           "invalid output dtype");
+
+  // Number of ROIs
+  int num_rois = rois.size(0);
+  int size_rois = rois.size(1);
+
+  if (size_rois != 5) {
+    printf("wrong roi size\n");
+    return 0;
+  }
+
+  int channels = features.size(1);
+  int height = features.size(2);
+  int width = features.size(3);
+  AT_CHECK(scales.numel() == zero_points.numel() &&
+               (scales.numel() == 1 || scales.numel() == channels),
+           "scales and zero_points must have 1 or channels elements");
+  // number of channels processed by a single work item
+  AT_CHECK(channels_per_item > 0, "channels_per_item must be positive");
+
+#define LAUNCH_QUANTIZED(q_t, out_t)                                         \
+  ROIAlignForwardQuantizedLauncherCPU<q_t, out_t>(                           \
+      features, rois, num_rois, channels, height, width, pooled_height,      \
+      pooled_width, spatial_scale, sample_num, scales, zero_points,          \
+      out_scale, out_zero_point, channels_per_item, output)
+
+  if (type == at::kByte) {
+    if (out_scale > 0) {
+      LAUNCH_QUANTIZED(uint8_t, uint8_t);
+    } else {
+      LAUNCH_QUANTIZED(uint8_t, float);
+    }
+  } else {
+    if (out_scale > 0) {
+      LAUNCH_QUANTIZED(int8_t, int8_t);
+    } else {
+      LAUNCH_QUANTIZED(int8_t, float);
+    }
+  }
+#undef LAUNCH_QUANTIZED
+
+  return 1;
+}
+
+PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
+  m.def("forward", &roi_align_forward_cpu, "Roi_Align forward (CPU)");
+  m.def("backward", &roi_align_backward_cpu, "Roi_Align backward (CPU)");
+  m.def("forward_quantized", &roi_align_forward_quantized_cpu,
+        "Roi_Align quantized forward (CPU)");
+}
@@ -8,14 +8,15 @@ int ROIAlignForwardLaucher(const at::Tensor features, const at::Tensor rois,
                            const int channels, const int height,
                            const int width, const int num_rois,
                            const int pooled_height, const int pooled_width,
-                           at::Tensor output);
+                           at::Tensor output, const int threads_per_block);
 
 int ROIAlignBackwardLaucher(const at::Tensor top_grad, const at::Tensor rois,
                             const float spatial_scale, const int sample_num,
                             const int channels, const int height,
                             const int width, const int num_rois,
                             const int pooled_height, const int pooled_width,
-                            at::Tensor bottom_grad);
+                            at::Tensor bottom_grad,
+                            const int threads_per_block);
 
 #define CHECK_CUDA(x) AT_CHECK(x.type().is_cuda(), #x, " must be a CUDAtensor ")
 #define CHECK_CONTIGUOUS(x) \
@@ -23,14 +24,18 @@ int ROIAlignBackwardLaucher(const at::Tensor top_grad, const at::Tensor rois,
 #define CHECK_INPUT(x) \
   CHECK_CUDA(x);       \
   CHECK_CONTIGUOUS(x)
+#define CHECK_THREADS(x)                          \
+  AT_CHECK(x > 0 && x <= 1024 && x % 32 == 0, #x, \
+           " must be a multiple of 32 in (0, 1024] ")
 
 int roi_align_forward_cuda(at::Tensor features, at::Tensor rois,
                            int pooled_height, int pooled_width,
                            float spatial_scale, int sample_num,
-                           at::Tensor output) {
+                           at::Tensor output, int threads_per_block) {
   CHECK_INPUT(features);
   CHECK_INPUT(rois);
   CHECK_INPUT(output);
+  CHECK_THREADS(threads_per_block);
 
   // Number of ROIs
   int num_rois = rois.size(0);
@@ -47,7 +52,8 @@ int roi_align_forward_cuda(at::Tensor features, at::Tensor rois,
 
   ROIAlignForwardLaucher(features, rois, spatial_scale, sample_num,
                          num_channels, data_height, data_width, num_rois,
-                         pooled_height, pooled_width, output);
+                         pooled_height, pooled_width, output,
+                         threads_per_block);
 
   return 1;
 }
@@ -55,10 +61,11 @@ int roi_align_forward_cuda(at::Tensor features, at::Tensor rois,
 int roi_align_backward_cuda(at::Tensor top_grad, at::Tensor rois,
                             int pooled_height, int pooled_width,
                             float spatial_scale, int sample_num,
-                            at::Tensor bottom_grad) {
+                            at::Tensor bottom_grad, int threads_per_block) {
   CHECK_INPUT(top_grad);
   CHECK_INPUT(rois);
   CHECK_INPUT(bottom_grad);
+  CHECK_THREADS(threads_per_block);
 
   // Number of ROIs
   int num_rois = rois.size(0);
@@ -74,7 +81,8 @@ int roi_align_backward_cuda(at::Tensor top_grad, at::Tensor rois,
 
   ROIAlignBackwardLaucher(top_grad, rois, spatial_scale, sample_num,
                           num_channels, data_height, data_width, num_rois,
-                          pooled_height, pooled_width, bottom_grad);
+                          pooled_height, pooled_width, bottom_grad,
+                          threads_per_block);
 
   return 1;
 }
@@ -7,10 +7,10 @@ using namespace at;  // temporal fix for pytorch<=0.4.1 (see #9848)
   for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < n; \
        i += blockDim.x * gridDim.x)
 
-#define THREADS_PER_BLOCK 1024
-
-inline int GET_BLOCKS(const int N) {
-  int optimal_block_num = (N + THREADS_PER_BLOCK - 1) / THREADS_PER_BLOCK;
+// the kernels use grid-stride loops, so the grid is capped to stay within
+// the gridDim.x limit of older devices
+inline int GET_BLOCKS(const int N, const int threads_per_block) {
+  int optimal_block_num = (N + threads_per_block - 1) / threads_per_block;
   int max_block_num = 65000;
   return min(optimal_block_num, max_block_num);
 }
@@ -130,7 +130,7 @@ int ROIAlignForwardLaucher(const at::Tensor features, const at::Tensor rois,
                            const int channels, const int height,
                            const int width, const int num_rois,
                            const int pooled_height, const int pooled_width,
-                           at::Tensor output) {
+                           at::Tensor output, const int threads_per_block) {
   const int output_size = num_rois * pooled_height * pooled_width * channels;
   AT_DISPATCH_FLOATING_TYPES_AND_HALF(
       features.type(), "ROIAlignLaucherForward", ([&] {
@@ -139,15 +139,15 @@ int ROIAlignForwardLaucher(const at::Tensor features, const at::Tensor rois,
         scalar_t *top_data = output.data<scalar_t>();
 
         ROIAlignForward<scalar_t>
-            <<<GET_BLOCKS(output_size), THREADS_PER_BLOCK>>>(
+            <<<GET_BLOCKS(output_size, threads_per_block),
+               threads_per_block>>>(
                 output_size, bottom_data, rois_data, scalar_t(spatial_scale),
                 sample_num, channels, height, width, pooled_height,
                 pooled_width, top_data);
       }));
   cudaError_t err = cudaGetLastError();
   if (cudaSuccess != err) {
-    fprintf(stderr, "cudaCheckError() failed : %s\n", cudaGetErrorString(err));
-    exit(-1);
+    AT_ERROR("cudaCheckError() failed : ", cudaGetErrorString(err));
   }
 
   return 1;
@@ -277,7 +277,8 @@ int ROIAlignBackwardLaucher(const at::Tensor top_grad, const at::Tensor rois,
                             const int channels, const int height,
                             const int width, const int num_rois,
                             const int pooled_height, const int pooled_width,
-                            at::Tensor bottom_grad) {
+                            at::Tensor bottom_grad,
+                            const int threads_per_block) {
   const int output_size = num_rois * pooled_height * pooled_width * channels;
 
   // TODO: use AT_DISPATCH_FLOATING_TYPES_AND_HALF when atomicAdd is resolved
@@ -292,15 +293,15 @@ int ROIAlignBackwardLaucher(const at::Tensor top_grad, const at::Tensor rois,
         }
 
         ROIAlignBackward<scalar_t>
-            <<<GET_BLOCKS(output_size), THREADS_PER_BLOCK>>>(
+            <<<GET_BLOCKS(output_size, threads_per_block),
+               threads_per_block>>>(
                 output_size, top_diff, rois_data, spatial_scale, sample_num,
                 channels, height, width, pooled_height, pooled_width,
                 bottom_diff);
       }));
   cudaError_t err = cudaGetLastError();
   if (cudaSuccess != err) {
-    fprintf(stderr, "cudaCheckError() failed : %s\n", cudaGetErrorString(err));
-    exit(-1);
+    AT_ERROR("cudaCheckError() failed : ", cudaGetErrorString(err));
   }
 
   return 1;
@@ -1,13 +1,33 @@
 import torch
 from torch.autograd import Function
 
-from .. import roi_pool_cuda
+from .. import roi_pool_cpu, roi_pool_cuda
+from mmdet.ops.autotune import CPU_CHANNELS_PER_ITEM, CUDA_THREADS, autotuner
+from ...roi_sort import sort_rois, unsort_rois
+
+
+def _tuned_run(op, features, num_rois, out_h, out_w, fn):
+    """Call ``fn(launch)`` with the tuned launch parameter for these shapes,
+    the threads per block of the CUDA kernel or the channels per work item
+    of the CPU kernel."""
+    key = autotuner.make_key(
+        features, features.shape[1:], (num_rois, ), out_size=(out_h, out_w))
+    if features.is_cuda:
+        autotuner.run(op, key, 'threads', CUDA_THREADS, fn, True)
+    else:
+        autotuner.run(op, key, 'channels_per_item', CPU_CHANNELS_PER_ITEM, fn)
 
 
 class RoIPoolFunction(Function):
 
     @staticmethod
-    def forward(ctx, features, rois, out_size, spatial_scale):
+    def forward(ctx,
+                features,
+                rois,
+                out_size,
+                spatial_scale,
+                reorder=False,
+                out_dtype=None):
         if isinstance(out_size, int):
             out_h = out_size
             out_w = out_size
@@ -19,25 +39,53 @@ class RoIPoolFunction(Function):
         else:
             raise TypeError(
                 '"out_size" must be an integer or tuple of integers')
-        assert features.is_cuda
+        if out_dtype is None:
+            out_dtype = features.dtype
+        if not features.is_cuda and features.dtype == torch.half:
+            # fp16 features are compared and their gradients accumulated in
+            # fp32, which is the dtype the CPU kernels expect rois in
+            rois = rois.float()
         ctx.save_for_backward(rois)
+        # process rois in (batch index, spatial tile) order, which does not
+        # change the results but improves the cache hit rate. The CPU kernels
+        # start the most expensive rois first, but keep this order among
+        # rois whose costs round down to the same power of two
+        if reorder:
+            rois, ctx.order = sort_rois(rois, spatial_scale,
+                                        features.shape[2:])
+        else:
+            ctx.order = None
         num_channels = features.size(1)
         num_rois = rois.size(0)
         out_size = (num_rois, num_channels, out_h, out_w)
-        output = features.new_zeros(*out_size)
+        # the kernels write outputs in the dtype of the features or of the
+        # rois, other dtypes are converted afterwards
+        output = features.new_zeros(
+            *out_size,
+            dtype=out_dtype if out_dtype == rois.dtype else features.dtype)
 
         argmax = features.new_zeros(*out_size, dtype=torch.int)
-        roi_pool_cuda.forward(features, rois, out_h, out_w, spatial_scale,
-                              output, argmax)
+        roi_pool_ext = roi_pool_cuda if features.is_cuda else roi_pool_cpu
+
+        def run(launch):
+            # every output element is written, repeated runs are harmless
+            roi_pool_ext.forward(features, rois, out_h, out_w, spatial_scale,
+                                 output, argmax, launch)
+
+        _tuned_run('roi_pool_forward', features, num_rois, out_h, out_w, run)
         ctx.spatial_scale = spatial_scale
         ctx.feature_size = features.size()
-        ctx.argmax = argmax
+        ctx.feature_dtype = features.dtype
 
-        return output
+        # rois and argmax are kept in the caller's order, like the output
+        if ctx.order is not None:
+            output = unsort_rois(output, ctx.order)
+            argmax = unsort_rois(argmax, ctx.order)
+        ctx.argmax = argmax
+        return output.to(out_dtype)
 
     @staticmethod
     def backward(ctx, grad_output):
-        assert grad_output.is_cuda
         spatial_scale = ctx.spatial_scale
         feature_size = ctx.feature_size
         argmax = ctx.argmax
@@ -46,11 +94,33 @@ class RoIPoolFunction(Function):
 
         grad_input = grad_rois = None
         if ctx.needs_input_grad[0]:
-            grad_input = grad_output.new(feature_size).zero_()
-            roi_pool_cuda.backward(grad_output, rois, argmax, spatial_scale,
-                                   grad_input)
+            grad_input = grad_output.new_zeros(
+                feature_size, dtype=ctx.feature_dtype)
+            if grad_output.dtype != rois.dtype:
+                grad_output = grad_output.to(ctx.feature_dtype)
+            if grad_output.is_cuda:
+                roi_pool_ext = roi_pool_cuda
+                if ctx.order is not None:
+                    rois = rois[ctx.order].contiguous()
+                    argmax = argmax[ctx.order].contiguous()
+                    grad_output = grad_output[ctx.order]
+            else:
+                # the CPU backward already groups rois by image, keeping the
+                # original order inside an image keeps the summation order
+                # and thus the result unchanged
+                roi_pool_ext = roi_pool_cpu
+            grad_output = grad_output.contiguous()
+
+            def run(launch):
+                # the gradients are accumulated, start over on every run
+                grad_input.zero_()
+                roi_pool_ext.backward(grad_output, rois, argmax, spatial_scale,
+                                      grad_input, launch)
+
+            _tuned_run('roi_pool_backward', grad_input, rois.size(0),
+                       grad_output.size(2), grad_output.size(3), run)
 
-        return grad_input, grad_rois, None, None
+        return grad_input, grad_rois, None, None, None, None
 
 
 roi_pool = RoIPoolFunction.apply
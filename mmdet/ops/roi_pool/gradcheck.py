@@ -1,15 +1,67 @@
+import numpy as np
 import torch
 from torch.autograd import gradcheck
 
 import os.path as osp
 import sys
-sys.path.append(osp.abspath(osp.join(__file__, '../../')))
-from roi_pool import RoIPool  # noqa: E402
+# the ops import each other relatively, import them from the repository
+sys.path.append(osp.abspath(osp.join(__file__, '../../../../')))
+from mmdet.ops.roi_pool import RoIPool  # noqa: E402
 
-feat = torch.randn(4, 16, 15, 15, requires_grad=True).cuda()
+feat = torch.randn(4, 16, 15, 15)
 rois = torch.Tensor([[0, 0, 0, 50, 50], [0, 10, 30, 43, 55],
-                     [1, 67, 40, 110, 120]]).cuda()
-inputs = (feat, rois)
-print('Gradcheck for roi pooling...')
-test = gradcheck(RoIPool(4, 1.0 / 8), inputs, eps=1e-5, atol=1e-3)
+                     [1, 67, 40, 110, 120]])
+
+feat_cpu = feat.double().requires_grad_()
+rois_cpu = rois.double()
+print('Gradcheck for roi pooling (CPU)...')
+test = gradcheck(
+    RoIPool(4, 1.0 / 8), (feat_cpu, rois_cpu), eps=1e-5, atol=1e-3)
 print(test)
+
+if torch.cuda.is_available():
+    inputs = (feat.cuda().requires_grad_(), rois.cuda())
+    print('Gradcheck for roi pooling...')
+    test = gradcheck(RoIPool(4, 1.0 / 8), inputs, eps=1e-5, atol=1e-3)
+    print(test)
+
+# fp16 storage on the CPU is compared in fp32, check the forward errors of
+# the reduced precision table in TECHNICAL_DETAILS.md (at most twice the
+# table values for fp16 storage)
+print('Errors of roi pooling (CPU) against fp64...')
+shape = (2, 64, 50, 84)
+scale = 1.0 / 16
+sizes = np.exp(np.log(8) + np.random.rand(300, 2) * np.log(100))
+corners = np.random.rand(300, 2) * (
+    np.array([shape[3], shape[2]]) / scale - sizes)
+big_rois = torch.from_numpy(
+    np.hstack((np.arange(300)[:, None] % shape[0], corners,
+               corners + sizes))).double()
+big_feat = torch.randn(*shape, dtype=torch.double)
+ref = RoIPool(7, scale)(big_feat, big_rois)
+for name, dtype, mean_rel, max_abs in [('fp32', torch.float, 1e-4, None),
+                                       ('fp16 storage', torch.half, 3.6e-4,
+                                        3.8e-3)]:
+    output = RoIPool(
+        7, scale, out_dtype=torch.float)(big_feat.to(dtype), big_rois.float())
+    diff = (output.double() - ref).abs()
+    max_err = diff.max().item()
+    mean_rel_err = (diff.sum() / ref.abs().sum()).item()
+    print('fwd {}: max abs err {:.3g}, mean rel err {:.3g}'.format(
+        name, max_err, mean_rel_err))
+    assert mean_rel_err < mean_rel, name
+    assert max_abs is None or max_err < max_abs, name
+
+# reordering the rois must not change the outputs nor the gradients, which
+# the CPU backward sums in the original order of the rois of an image
+print('Reordered roi pooling (CPU)...')
+grad = torch.randn(300, shape[1], 7, 7)
+grads = []
+for reorder in (False, True):
+    x = big_feat.float().requires_grad_()
+    output = RoIPool(7, scale, reorder=reorder)(x, big_rois.float())
+    output.backward(grad)
+    grads.append((output.detach(), x.grad))
+assert torch.equal(grads[0][0], grads[1][0]), 'output'
+assert torch.equal(grads[0][1], grads[1][1]), 'grad input'
+print('OK')
@@ -4,11 +4,15 @@ from ..functions.roi_pool import roi_pool
 
 class RoIPool(Module):
 
-    def __init__(self, out_size, spatial_scale):
+    def __init__(self, out_size, spatial_scale, reorder=False,
+                 out_dtype=None):
         super(RoIPool, self).__init__()
 
         self.out_size = out_size
         self.spatial_scale = float(spatial_scale)
+        self.reorder = reorder
+        self.out_dtype = out_dtype
 
     def forward(self, features, rois):
-        return roi_pool(features, rois, self.out_size, self.spatial_scale)
+        return roi_pool(features, rois, self.out_size, self.spatial_scale,
+                        self.reorder, self.out_dtype)
@@ -1,5 +1,11 @@
+import os.path as osp
+
 from setuptools import setup
-from torch.utils.cpp_extension import BuildExtension, CUDAExtension
+from torch.utils.cpp_extension import (BuildExtension, CppExtension,
+                                       CUDAExtension)
+
+# cpu_utils.h, shared by the CPU implementations of the ops
+common_dir = osp.join(osp.dirname(osp.abspath(__file__)), '..', 'common')
 
 setup(
     name='roi_pool',
@@ -7,6 +13,11 @@ setup(
         CUDAExtension('roi_pool_cuda', [
             'src/roi_pool_cuda.cpp',
             'src/roi_pool_kernel.cu',
-        ])
+        ]),
+        CppExtension(
+            'roi_pool_cpu', ['src/roi_pool_cpu.cpp'],
+            include_dirs=[common_dir],
+            extra_compile_args=['-O3', '-fopenmp'],
+            extra_link_args=['-fopenmp']),
     ],
     cmdclass={'build_ext': BuildExtension})
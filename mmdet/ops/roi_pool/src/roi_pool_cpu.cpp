@@ -0,0 +1,306 @@
+#include <torch/torch.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "cpu_utils.h"
+
+#define CHECK_CPU(x) AT_CHECK(!x.type().is_cuda(), #x, " must be a CPU tensor ")
+#define CHECK_CONTIGUOUS(x) \
+  AT_CHECK(x.is_contiguous(), #x, " must be contiguous ")
+#define CHECK_INPUT(x) \
+  CHECK_CPU(x);        \
+  CHECK_CONTIGUOUS(x)
+
+// Clipped bins of a roi, x1/x2 (y1/y2) are the column (row) ranges of the
+// pooled columns (rows).
+struct RoIBins {
+  int batch_ind;
+  bool valid;
+  std::vector<int> x1, x2, y1, y2;
+};
+
+// Same arithmetic as ROIPoolForward in roi_pool_kernel.cu
+template <typename acc_t>
+std::vector<RoIBins> get_roi_bins(const acc_t *rois, const int num_rois,
+                                  const acc_t spatial_scale, const int height,
+                                  const int width, const int pooled_h,
+                                  const int pooled_w) {
+  std::vector<RoIBins> bins(num_rois);
+  for (int n = 0; n < num_rois; n++) {
+    const acc_t *offset_rois = rois + n * 5;
+    RoIBins &b = bins[n];
+    b.batch_ind = offset_rois[0];
+    // calculate the roi region on feature maps
+    acc_t roi_x1 = offset_rois[1] * spatial_scale;
+    acc_t roi_y1 = offset_rois[2] * spatial_scale;
+    acc_t roi_x2 = (offset_rois[3] + 1) * spatial_scale;
+    acc_t roi_y2 = (offset_rois[4] + 1) * spatial_scale;
+
+    acc_t roi_w = roi_x2 - roi_x1;
+    acc_t roi_h = roi_y2 - roi_y1;
+    b.valid = roi_w > 0 && roi_h > 0;
+    if (!b.valid) continue;
+
+    acc_t bin_size_w = roi_w / static_cast<acc_t>(pooled_w);
+    acc_t bin_size_h = roi_h / static_cast<acc_t>(pooled_h);
+
+    // the corresponding bin region, clipped to the input boundaries
+    for (int pw = 0; pw < pooled_w; pw++) {
+      int x1 = std::floor(static_cast<acc_t>(pw) * bin_size_w + roi_x1);
+      int x2 = std::ceil(static_cast<acc_t>(pw + 1) * bin_size_w + roi_x1);
+      b.x1.push_back(std::min(std::max(x1, 0), width));
+      b.x2.push_back(std::min(std::max(x2, 0), width));
+    }
+    for (int ph = 0; ph < pooled_h; ph++) {
+      int y1 = std::floor(static_cast<acc_t>(ph) * bin_size_h + roi_y1);
+      int y2 = std::ceil(static_cast<acc_t>(ph + 1) * bin_size_h + roi_y1);
+      b.y1.push_back(std::min(std::max(y1, 0), height));
+      b.y2.push_back(std::min(std::max(y2, 0), height));
+    }
+  }
+  return bins;
+}
+
+// Number of feature elements compared for one output channel of a roi
+inline int64_t roi_cost(const RoIBins &b) {
+  if (!b.valid) return 1;
+  int64_t rows = 0, cols = 0;
+  for (size_t i = 0; i < b.y1.size(); i++) rows += b.y2[i] - b.y1[i];
+  for (size_t i = 0; i < b.x1.size(); i++) cols += b.x2[i] - b.x1[i];
+  return std::max<int64_t>(rows * cols, 1);
+}
+
+template <typename scalar_t, typename out_t, typename acc_t>
+void ROIPoolForwardCPU(const scalar_t *bottom_data, const RoIBins &b,
+                       const int c_start, const int c_end, const int channels,
+                       const int height, const int width, const int pooled_h,
+                       const int pooled_w, out_t *top_data,
+                       int *argmax_data) {
+  for (int c = c_start; c < c_end; c++) {
+    const scalar_t *offset_bottom_data =
+        bottom_data + (b.batch_ind * channels + c) * height * width;
+    for (int ph = 0; ph < pooled_h; ph++) {
+      for (int pw = 0; pw < pooled_w; pw++) {
+        const int index = (c * pooled_h + ph) * pooled_w + pw;
+        // Malformed rois are skipped by the CUDA kernel, they are written as
+        // empty bins here so that the output does not depend on its initial
+        // value.
+        const bool is_empty = !b.valid || b.y2[ph] <= b.y1[ph] ||
+                              b.x2[pw] <= b.x1[pw];
+        // If nothing is pooled, argmax = -1 causes nothing to be backprop'd
+        int max_idx = -1;
+        // Define an empty pooling region to be zero
+        acc_t max_val = 0;
+        if (!is_empty) {
+          max_val = static_cast<acc_t>(
+                        offset_bottom_data[b.y1[ph] * width + b.x1[pw]]) -
+                    1;
+          for (int h = b.y1[ph]; h < b.y2[ph]; ++h) {
+            for (int w = b.x1[pw]; w < b.x2[pw]; ++w) {
+              const int offset = h * width + w;
+              const acc_t val = offset_bottom_data[offset];
+              if (val > max_val) {
+                max_val = val;
+                max_idx = offset;
+              }
+            }
+          }
+        }
+        top_data[index] = static_cast<out_t>(max_val);
+        argmax_data[index] = max_idx;
+      }
+    }
+  }
+}
+
+template <typename scalar_t, typename out_t>
+void ROIPoolForwardLauncherCPU(const at::Tensor features,
+                               const at::Tensor rois, const int num_rois,
+                               const int channels, const int height,
+                               const int width, const int pooled_h,
+                               const int pooled_w, const float spatial_scale,
+                               const int channels_per_item, at::Tensor output,
+                               at::Tensor argmax) {
+  typedef typename acc_type<scalar_t>::type acc_t;
+  const int num_blocks = (channels + channels_per_item - 1) / channels_per_item;
+  const scalar_t *bottom_data = features.data<scalar_t>();
+  out_t *top_data = output.data<out_t>();
+  int *argmax_data = argmax.data<int>();
+  const auto bins =
+      get_roi_bins<acc_t>(rois.data<acc_t>(), num_rois, acc_t(spatial_scale),
+                          height, width, pooled_h, pooled_w);
+
+  // one work item per (roi, block of channels)
+  std::vector<int64_t> cost(static_cast<int64_t>(num_rois) * num_blocks);
+  for (int n = 0; n < num_rois; n++) {
+    std::fill(cost.begin() + n * num_blocks,
+              cost.begin() + (n + 1) * num_blocks, roi_cost(bins[n]));
+  }
+  parallel_for_cost(cost, [&](int64_t item) {
+    const int n = item / num_blocks;
+    const int c_start = (item % num_blocks) * channels_per_item;
+    const int c_end = std::min(c_start + channels_per_item, channels);
+    const int64_t offset = static_cast<int64_t>(n) * channels * pooled_h *
+                           pooled_w;
+    ROIPoolForwardCPU<scalar_t, out_t, acc_t>(
+        bottom_data, bins[n], c_start, c_end, channels, height, width,
+        pooled_h, pooled_w, top_data + offset, argmax_data + offset);
+  });
+}
+
+template <typename scalar_t, typename out_t>
+void ROIPoolBackwardLauncherCPU(const at::Tensor top_grad,
+                                const at::Tensor rois,
+                                const at::Tensor argmax, const int num_rois,
+                                const int batch_size, const int channels,
+                                const int height, const int width,
+                                const int pooled_h, const int pooled_w,
+                                const int channels_per_item,
+                                at::Tensor bottom_grad) {
+  typedef typename acc_type<scalar_t>::type acc_t;
+  const int num_blocks = (channels + channels_per_item - 1) / channels_per_item;
+  const out_t *top_diff = top_grad.data<out_t>();
+  const acc_t *rois_data = rois.data<acc_t>();
+  const int *argmax_data = argmax.data<int>();
+  scalar_t *bottom_diff = bottom_grad.data<scalar_t>();
+
+  // One work item per (image, block of channels), which scatters the
+  // gradients of all rois of that image, so that no atomics are needed and
+  // the result is deterministic.
+  std::vector<std::vector<int>> rois_per_image(batch_size);
+  for (int n = 0; n < num_rois; n++) {
+    const int b = rois_data[n * 5];
+    AT_CHECK(b >= 0 && b < batch_size, "invalid batch index of roi ", n);
+    rois_per_image[b].push_back(n);
+  }
+  std::vector<int64_t> cost(static_cast<int64_t>(batch_size) * num_blocks);
+  for (int b = 0; b < batch_size; b++) {
+    std::fill(cost.begin() + b * num_blocks,
+              cost.begin() + (b + 1) * num_blocks,
+              static_cast<int64_t>(rois_per_image[b].size()));
+  }
+  const int pooled_size = pooled_h * pooled_w;
+  parallel_for_cost(cost, [&](int64_t item) {
+    const int b = item / num_blocks;
+    const int c_start = (item % num_blocks) * channels_per_item;
+    const int c_end = std::min(c_start + channels_per_item, channels);
+    Accumulator<scalar_t, acc_t> accumulator;
+    acc_t *acc_diff = accumulator.begin(
+        bottom_diff + (b * channels + c_start) * height * width,
+        (c_end - c_start) * height * width);
+    for (const int n : rois_per_image[b]) {
+      for (int c = c_start; c < c_end; c++) {
+        const int64_t offset =
+            (static_cast<int64_t>(n) * channels + c) * pooled_size;
+        acc_t *offset_acc_diff = acc_diff + (c - c_start) * height * width;
+        for (int i = 0; i < pooled_size; i++) {
+          const int bottom_index = argmax_data[offset + i];
+          if (bottom_index >= 0) {
+            offset_acc_diff[bottom_index] +=
+                static_cast<acc_t>(top_diff[offset + i]);
+          }
+        }
+      }
+    }
+    accumulator.end();
+  });
+}
+
+int roi_pooling_forward_cpu(at::Tensor features, at::Tensor rois,
+                            int pooled_height, int pooled_width,
+                            float spatial_scale, at::Tensor output,
+                            at::Tensor argmax, int channels_per_item) {
+  CHECK_INPUT(features);
+  CHECK_INPUT(rois);
+  CHECK_INPUT(output);
+  CHECK_INPUT(argmax);
+  check_types(features, rois, output);
+
+  // Number of ROIs
+  int num_rois = rois.size(0);
+  int size_rois = rois.size(1);
+
+  if (size_rois != 5) {
+    printf("wrong roi size\n");
+    return 0;
+  }
+
+  int channels = features.size(1);
+  int height = features.size(2);
+  int width = features.size(3);
+  // number of channels processed by a single work item
+  AT_CHECK(channels_per_item > 0, "channels_per_item must be positive");
+
+  const bool out_acc =
+      output.type().scalarType() != features.type().scalarType();
+  AT_DISPATCH_FLOATING_TYPES_AND_HALF(
+      features.type(), "ROIPoolForwardCPU", ([&] {
+        typedef typename acc_type<scalar_t>::type acc_t;
+        if (out_acc) {
+          ROIPoolForwardLauncherCPU<scalar_t, acc_t>(
+              features, rois, num_rois, channels, height, width,
+              pooled_height, pooled_width, spatial_scale, channels_per_item,
+              output, argmax);
+        } else {
+          ROIPoolForwardLauncherCPU<scalar_t, scalar_t>(
+              features, rois, num_rois, channels, height, width,
+              pooled_height, pooled_width, spatial_scale, channels_per_item,
+              output, argmax);
+        }
+      }));
+
+  return 1;
+}
+
+int roi_pooling_backward_cpu(at::Tensor top_grad, at::Tensor rois,
+                             at::Tensor argmax, float spatial_scale,
+                             at::Tensor bottom_grad, int channels_per_item) {
+  CHECK_INPUT(top_grad);
+  CHECK_INPUT(rois);
+  CHECK_INPUT(argmax);
+  CHECK_INPUT(bottom_grad);
+  check_types(bottom_grad, rois, top_grad);
+
+  int pooled_height = top_grad.size(2);
+  int pooled_width = top_grad.size(3);
+  int num_rois = rois.size(0);
+  int size_rois = rois.size(1);
+
+  if (size_rois != 5) {
+    printf("wrong roi size\n");
+    return 0;
+  }
+  int batch_size = bottom_grad.size(0);
+  int channels = bottom_grad.size(1);
+  int height = bottom_grad.size(2);
+  int width = bottom_grad.size(3);
+  // number of channels processed by a single work item
+  AT_CHECK(channels_per_item > 0, "channels_per_item must be positive");
+
+  const bool out_acc =
+      top_grad.type().scalarType() != bottom_grad.type().scalarType();
+  AT_DISPATCH_FLOATING_TYPES_AND_HALF(
+      bottom_grad.type(), "ROIPoolBackwardCPU", ([&] {
+        typedef typename acc_type<scalar_t>::type acc_t;
+        if (out_acc) {
+          ROIPoolBackwardLauncherCPU<scalar_t, acc_t>(
+              top_grad, rois, argmax, num_rois, batch_size, channels, height,
+              width, pooled_height, pooled_width, channels_per_item,
+              bottom_grad);
+        } else {
+          ROIPoolBackwardLauncherCPU<scalar_t, scalar_t>(
+              top_grad, rois, argmax, num_rois, batch_size, channels, height,
+              width, pooled_height, pooled_width, channels_per_item,
+              bottom_grad);
+        }
+      }));
+
+  return 1;
+}
+
+PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
+  m.def("forward", &roi_pooling_forward_cpu, "Roi_Pooling forward (CPU)");
+  m.def("backward", &roi_pooling_backward_cpu, "Roi_Pooling backward (CPU)");
+}
@@ -7,14 +7,16 @@ int ROIPoolForwardLaucher(const at::Tensor features, const at::Tensor rois,
                           const float spatial_scale, const int channels,
                           const int height, const int width, const int num_rois,
                           const int pooled_h, const int pooled_w,
-                          at::Tensor output, at::Tensor argmax);
+                          at::Tensor output, at::Tensor argmax,
+                          const int threads_per_block);
 
 int ROIPoolBackwardLaucher(const at::Tensor top_grad, const at::Tensor rois,
                            const at::Tensor argmax, const float spatial_scale,
                            const int batch_size, const int channels,
                            const int height, const int width,
                            const int num_rois, const int pooled_h,
-                           const int pooled_w, at::Tensor bottom_grad);
+                           const int pooled_w, at::Tensor bottom_grad,
+                           const int threads_per_block);
 
 #define CHECK_CUDA(x) AT_CHECK(x.type().is_cuda(), #x, " must be a CUDAtensor ")
 #define CHECK_CONTIGUOUS(x) \
@@ -22,15 +24,19 @@ int ROIPoolBackwardLaucher(const at::Tensor top_grad, const at::Tensor rois,
 #define CHECK_INPUT(x) \
   CHECK_CUDA(x);       \
   CHECK_CONTIGUOUS(x)
+#define CHECK_THREADS(x)                          \
+  AT_CHECK(x > 0 && x <= 1024 && x % 32 == 0, #x, \
+           " must be a multiple of 32 in (0, 1024] ")
 
 int roi_pooling_forward_cuda(at::Tensor features, at::Tensor rois,
                              int pooled_height, int pooled_width,
                              float spatial_scale, at::Tensor output,
-                             at::Tensor argmax) {
+                             at::Tensor argmax, int threads_per_block) {
   CHECK_INPUT(features);
   CHECK_INPUT(rois);
   CHECK_INPUT(output);
   CHECK_INPUT(argmax);
+  CHECK_THREADS(threads_per_block);
 
   // Number of ROIs
   int num_rois = rois.size(0);
@@ -46,18 +52,20 @@ int roi_pooling_forward_cuda(at::Tensor features, at::Tensor rois,
   int width = features.size(3);
 
   ROIPoolForwardLaucher(features, rois, spatial_scale, channels, height, width,
-                        num_rois, pooled_height, pooled_width, output, argmax);
+                        num_rois, pooled_height, pooled_width, output, argmax,
+                        threads_per_block);
 
   return 1;
 }
 
 int roi_pooling_backward_cuda(at::Tensor top_grad, at::Tensor rois,
                               at::Tensor argmax, float spatial_scale,
-                              at::Tensor bottom_grad) {
+                              at::Tensor bottom_grad, int threads_per_block) {
   CHECK_INPUT(top_grad);
   CHECK_INPUT(rois);
   CHECK_INPUT(argmax);
   CHECK_INPUT(bottom_grad);
+  CHECK_THREADS(threads_per_block);
 
   int pooled_height = top_grad.size(2);
   int pooled_width = top_grad.size(3);
@@ -75,7 +83,7 @@ int roi_pooling_backward_cuda(at::Tensor top_grad, at::Tensor rois,
 
   ROIPoolBackwardLaucher(top_grad, rois, argmax, spatial_scale, batch_size,
                          channels, height, width, num_rois, pooled_height,
-                         pooled_width, bottom_grad);
+                         pooled_width, bottom_grad, threads_per_block);
 
   return 1;
 }
@@ -7,10 +7,10 @@ using namespace at;  // temporal fix for pytorch<=0.4.1 (see #9848)
   for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < n; \
        i += blockDim.x * gridDim.x)
 
-#define THREADS_PER_BLOCK 1024
-
-inline int GET_BLOCKS(const int N) {
-  int optimal_block_num = (N + THREADS_PER_BLOCK - 1) / THREADS_PER_BLOCK;
+// the kernels use grid-stride loops, so the grid is capped to stay within
+// the gridDim.x limit of older devices
+inline int GET_BLOCKS(const int N, const int threads_per_block) {
+  int optimal_block_num = (N + threads_per_block - 1) / threads_per_block;
   int max_block_num = 65000;
   return min(optimal_block_num, max_block_num);
 }
@@ -84,7 +84,8 @@ int ROIPoolForwardLaucher(const at::Tensor features, const at::Tensor rois,
                           const float spatial_scale, const int channels,
                           const int height, const int width, const int num_rois,
                           const int pooled_h, const int pooled_w,
-                          at::Tensor output, at::Tensor argmax) {
+                          at::Tensor output, at::Tensor argmax,
+                          const int threads_per_block) {
   const int output_size = num_rois * channels * pooled_h * pooled_w;
 
   AT_DISPATCH_FLOATING_TYPES_AND_HALF(
@@ -95,15 +96,15 @@ int ROIPoolForwardLaucher(const at::Tensor features, const at::Tensor rois,
         int *argmax_data = argmax.data<int>();
 
         ROIPoolForward<scalar_t>
-            <<<GET_BLOCKS(output_size), THREADS_PER_BLOCK>>>(
+            <<<GET_BLOCKS(output_size, threads_per_block),
+               threads_per_block>>>(
                 output_size, bottom_data, rois_data, scalar_t(spatial_scale),
                 channels, height, width, pooled_h, pooled_w, top_data,
                 argmax_data);
       }));
   cudaError_t err = cudaGetLastError();
   if (cudaSuccess != err) {
-    fprintf(stderr, "cudaCheckError() failed : %s\n", cudaGetErrorString(err));
-    exit(-1);
+    AT_ERROR("cudaCheckError() failed : ", cudaGetErrorString(err));
   }
   return 1;
 }
@@ -136,7 +137,8 @@ int ROIPoolBackwardLaucher(const at::Tensor top_grad, const at::Tensor rois,
                            const int batch_size, const int channels,
                            const int height, const int width,
                            const int num_rois, const int pooled_h,
-                           const int pooled_w, at::Tensor bottom_grad) {
+                           const int pooled_w, at::Tensor bottom_grad,
+                           const int threads_per_block) {
   const int output_size = num_rois * pooled_h * pooled_w * channels;
 
   // TODO: use AT_DISPATCH_FLOATING_TYPES_AND_HALF when atomicAdd is resolved
@@ -153,15 +155,15 @@ int ROIPoolBackwardLaucher(const at::Tensor top_grad, const at::Tensor rois,
         }
 
         ROIPoolBackward<scalar_t>
-            <<<GET_BLOCKS(output_size), THREADS_PER_BLOCK>>>(
+            <<<GET_BLOCKS(output_size, threads_per_block),
+               threads_per_block>>>(
                 output_size, top_diff, rois_data, argmax_data,
                 scalar_t(spatial_scale), channels, height, width, pooled_h,
                 pooled_w, bottom_diff);
       }));
   cudaError_t err = cudaGetLastError();
   if (cudaSuccess != err) {
-    fprintf(stderr, "cudaCheckError() failed : %s\n", cudaGetErrorString(err));
-    exit(-1);
+    AT_ERROR("cudaCheckError() failed : ", cudaGetErrorString(err));
   }
 
   return 1;
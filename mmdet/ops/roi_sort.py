@@ -0,0 +1,37 @@
+import torch
+
+
+def sort_rois(rois, spatial_scale, featmap_size, tile_size=16):
+    """Sort rois by (batch index, spatial tile) for better cache locality.
+
+    Rois produced by samplers interleave images and image regions, so
+    consecutive rois read unrelated parts of the feature map. Sorting them by
+    the image they belong to and the tile of the feature map their center
+    falls in makes neighbouring work items read neighbouring memory.
+
+    Args:
+        rois (Tensor): shape (n, 5), [batch_ind, x1, y1, x2, y2].
+        spatial_scale (float): Scale of the feature map w.r.t. the image.
+        featmap_size (tuple): (h, w) of the feature map.
+        tile_size (int): Tile size on the feature map.
+
+    Returns:
+        tuple: (sorted_rois, order), ``sorted_rois = rois[order]``.
+    """
+    h, w = featmap_size
+    num_tiles_y = (h + tile_size - 1) // tile_size
+    num_tiles_x = (w + tile_size - 1) // tile_size
+    ctr = (rois[:, 1:3] + rois[:, 3:5]) * (0.5 * spatial_scale / tile_size)
+    tile_x = ctr[:, 0].floor().clamp(0, num_tiles_x - 1).long()
+    tile_y = ctr[:, 1].floor().clamp(0, num_tiles_y - 1).long()
+    key = (rois[:, 0].long() * num_tiles_y + tile_y) * num_tiles_x + tile_x
+    _, order = torch.sort(key)
+    return rois[order].contiguous(), order
+
+
+def unsort_rois(sorted_data, order):
+    """Scatter per-roi data computed in sorted order back to the caller's
+    order, the inverse of ``sorted_data = data[order]``."""
+    data = sorted_data.new_empty(sorted_data.size())
+    data[order] = sorted_data
+    return data
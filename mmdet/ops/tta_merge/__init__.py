@@ -0,0 +1,8 @@
+from .tta_merge_wrapper import (aug_meta, merge_dets, merge_maps,
+                                merge_mapped_bboxes, merge_proposals,
+                                multiclass_nms)
+
+__all__ = [
+    'aug_meta', 'merge_dets', 'merge_maps', 'merge_mapped_bboxes',
+    'merge_proposals', 'multiclass_nms'
+]
@@ -0,0 +1,143 @@
+import mmcv
+import numpy as np
+import torch
+import torch.nn.functional as F
+
+import os.path as osp
+import sys
+# the merge functions are in mmdet.core, import them from the repository
+sys.path.append(osp.abspath(osp.join(__file__, '../../../../')))
+from mmdet.core import bbox_mapping, multiclass_nms  # noqa: E402
+from mmdet.core.post_processing import merge_augs  # noqa: E402
+from mmdet.ops import tta_merge  # noqa: E402
+
+
+def native_and_python(fn, *args, **kwargs):
+    """Results of a merge_aug_* function with the native op (enabled in the
+    test configs) and with the Python implementation it falls back to."""
+    native = fn(*args, **kwargs)
+    merge_augs.tta_merge = None
+    try:
+        python = fn(*args, **kwargs)
+    finally:
+        merge_augs.tta_merge = tta_merge
+    return native, python
+
+
+def check_close(name, native, python, atol=1e-4):
+    assert native.shape == python.shape, '{}: {} vs {}'.format(
+        name, native.shape, python.shape)
+    if isinstance(native, torch.Tensor):
+        native, python = native.cpu().numpy(), python.cpu().numpy()
+    assert np.allclose(native, python, rtol=1e-5, atol=atol), name
+
+
+def random_aug(img_shape, scales, num, num_classes, rng):
+    """Boxes around a few objects of the original image, mapped to every
+    (scale, flip) augmentation so that they overlap after the merge."""
+    h, w = img_shape
+    centers = rng.rand(8, 2) * [w, h]
+    sizes = rng.rand(8, 2) * [w, h] / 3 + 8
+    obj = rng.randint(8, size=num)
+    boxes = np.hstack((centers[obj] - sizes[obj] / 2,
+                       centers[obj] + sizes[obj] / 2))
+    metas, aug_bboxes, aug_proposals = [], [], []
+    for scale in scales:
+        for flip in (False, True):
+            img_info = dict(
+                img_shape=(int(h * scale + 0.5), int(w * scale + 0.5), 3),
+                scale_factor=scale,
+                flip=flip)
+            jitter = rng.randn(num, 4 * num_classes) * 4
+            bboxes = torch.from_numpy(
+                (np.tile(boxes, num_classes) + jitter).astype(np.float32))
+            bboxes = bbox_mapping(bboxes, img_info['img_shape'], scale, flip)
+            proposals = torch.cat(
+                [bboxes[:, :4], torch.rand(num, 1)], dim=1)
+            metas.append(img_info)
+            aug_bboxes.append(bboxes)
+            aug_proposals.append(proposals)
+    logits = torch.randn(len(metas), num, num_classes) * 3
+    aug_scores = list(F.softmax(logits, dim=2).unbind(0))
+    return metas, aug_bboxes, aug_scores, aug_proposals
+
+
+rng = np.random.RandomState(0)
+torch.manual_seed(0)
+num_classes = 21
+rcnn_test_cfg = mmcv.Config(
+    dict(
+        score_thr=0.05,
+        nms=dict(type='nms', iou_thr=0.5),
+        max_per_img=100,
+        native_merge=True))
+rpn_test_cfg = mmcv.Config(dict(nms_thr=0.7, max_num=300, native_merge=True))
+metas, aug_bboxes, aug_scores, aug_proposals = random_aug(
+    (480, 640), (0.8, 1.0, 1.25), 500, num_classes, rng)
+img_metas = [[img_info] for img_info in metas]
+
+# the merged boxes and scores are averaged in a different order, the
+# detections after suppression are compared exactly on the same inputs
+print('Native against Python merge of detections...')
+for weights in (None, [1, 2, 1, 2, 3, 1]):
+    (bboxes, scores), (py_bboxes, py_scores) = native_and_python(
+        merge_augs.merge_aug_bboxes, aug_bboxes, aug_scores, img_metas,
+        rcnn_test_cfg, weights)
+    check_close('bboxes', bboxes, py_bboxes, atol=1e-3)
+    check_close('scores', scores, py_scores, atol=1e-6)
+
+    dets, labels = tta_merge.multiclass_nms(py_bboxes, py_scores, 0.05, 0.5,
+                                            100)
+    py_dets, py_labels = multiclass_nms(py_bboxes, py_scores, 0.05,
+                                        rcnn_test_cfg.nms, 100)
+    assert torch.equal(dets, py_dets) and torch.equal(labels, py_labels)
+
+    (dets, labels), (py_dets, py_labels) = native_and_python(
+        merge_augs.merge_aug_dets, aug_bboxes, aug_scores, img_metas,
+        rcnn_test_cfg, weights)
+    assert dets.size(0) > 0
+    check_close('dets', dets, py_dets, atol=1e-3)
+    assert torch.equal(labels, py_labels)
+
+    # CUDA inputs are suppressed on the host with the CPU rule, the Python
+    # path uses the GPU NMS, which differs only at an IoU of exactly iou_thr
+    if torch.cuda.is_available():
+        (dets, labels), (py_dets, py_labels) = native_and_python(
+            merge_augs.merge_aug_dets, [b.cuda() for b in aug_bboxes],
+            [s.cuda() for s in aug_scores], img_metas, rcnn_test_cfg,
+            weights)
+        assert dets.is_cuda
+        check_close('cuda dets', dets, py_dets, atol=1e-3)
+        assert torch.equal(labels, py_labels)
+
+# the op is opt-in, without the flag both runs use the Python implementation
+plain_cfg = mmcv.Config(
+    dict(score_thr=0.05, nms=dict(type='nms', iou_thr=0.5), max_per_img=100))
+(dets, labels), (py_dets, py_labels) = native_and_python(
+    merge_augs.merge_aug_dets, aug_bboxes, aug_scores, img_metas, plain_cfg)
+assert torch.equal(dets, py_dets) and torch.equal(labels, py_labels)
+print('OK')
+
+print('Native against Python merge of proposals...')
+proposals, py_proposals = native_and_python(
+    merge_augs.merge_aug_proposals, aug_proposals, metas, rpn_test_cfg)
+assert 0 < proposals.size(0) <= rpn_test_cfg.max_num
+check_close('proposals', proposals, py_proposals, atol=1e-3)
+print('OK')
+
+# the Python path averages weighted masks in float64 (np.average), the
+# native op in float32
+print('Native against Python merge of masks and scores...')
+aug_masks = [
+    rng.rand(50, num_classes, 28, 28).astype(np.float32) for _ in metas
+]
+for weights in (None, [1, 2, 1, 2, 3, 1]):
+    masks, py_masks = native_and_python(merge_augs.merge_aug_masks,
+                                        aug_masks, img_metas, rcnn_test_cfg,
+                                        weights)
+    check_close('masks', masks, py_masks, atol=1e-6)
+    for scores in (aug_scores, [s.numpy() for s in aug_scores]):
+        merged, py_merged = native_and_python(
+            merge_augs.merge_aug_scores, scores, weights, native_merge=True)
+        check_close('scores', merged, py_merged, atol=1e-6)
+print('OK')
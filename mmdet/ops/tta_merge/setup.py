@@ -0,0 +1,18 @@
+import os.path as osp
+
+from setuptools import setup
+from torch.utils.cpp_extension import BuildExtension, CppExtension
+
+# cpu_utils.h, shared by the CPU implementations of the ops
+common_dir = osp.join(osp.dirname(osp.abspath(__file__)), '..', 'common')
+
+setup(
+    name='tta_merge_cpu',
+    ext_modules=[
+        CppExtension(
+            'tta_merge_cpu', ['src/tta_merge_cpu.cpp'],
+            include_dirs=[common_dir],
+            extra_compile_args=['-O3', '-fopenmp'],
+            extra_link_args=['-fopenmp']),
+    ],
+    cmdclass={'build_ext': BuildExtension})
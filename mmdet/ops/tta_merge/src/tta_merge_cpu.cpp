@@ -0,0 +1,369 @@
+#include <torch/torch.h>
+#include <ATen/Parallel.h>
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "cpu_utils.h"
+
+#define CHECK_CPU(x) AT_CHECK(!x.type().is_cuda(), #x, " must be a CPU tensor ")
+#define CHECK_CONTIGUOUS(x) \
+  AT_CHECK(x.is_contiguous(), #x, " must be contiguous ")
+#define CHECK_INPUT(x) \
+  CHECK_CPU(x);        \
+  CHECK_CONTIGUOUS(x)
+#define CHECK_FLOAT(x) \
+  AT_CHECK(x.type().scalarType() == at::kFloat, #x, " must be float ")
+
+// Merging of test-time augmentation results. The results of all
+// augmentations are mapped back to the original image, averaged and
+// suppressed in a few native passes, instead of a Python loop over the
+// augmentations followed by a Python loop over the classes.
+//
+// Every augmentation is described by a row of a (num_augs, 6) float tensor:
+// [flip, img_width, scale_x1, scale_y1, scale_x2, scale_y2], where
+// img_width is the width of the augmented image and the scales are the
+// scale_factor of the augmentation (repeated 4 times if it is a number).
+#define META_SIZE 6
+
+// Maps a row of boxes (x1, y1, x2, y2, x1, ...) of an augmentation back to
+// the original image, with the arithmetic of bbox_flip and bbox_mapping_back.
+static inline void map_back_row(const float *src, const int row_size,
+                                const float *meta, float *dst) {
+  const bool flip = meta[0] != 0.f;
+  const float width = meta[1];
+  const float *scale = meta + 2;
+  for (int i = 0; i + 3 < row_size; i += 4) {
+    float x1 = src[i], x2 = src[i + 2];
+    if (flip) {
+      x1 = width - src[i + 2] - 1;
+      x2 = width - src[i] - 1;
+    }
+    dst[i] = x1 / scale[0];
+    dst[i + 1] = src[i + 1] / scale[1];
+    dst[i + 2] = x2 / scale[2];
+    dst[i + 3] = src[i + 3] / scale[3];
+  }
+  // trailing columns (the scores of proposals) are copied as they are
+  for (int i = row_size - row_size % 4; i < row_size; i++) dst[i] = src[i];
+}
+
+// Weighted mean over the augmentations, row by row. load(a, row, buf) writes
+// the row of augmentation a into buf. Rows are accumulated in the output, so
+// the augmentations are never stacked.
+template <typename Load>
+void mean_rows(const int num_augs, const int64_t num_rows,
+               const int row_size, const float *weights, const Load &load,
+               float *output) {
+  float weight_sum = 0;
+  for (int a = 0; a < num_augs; a++) weight_sum += weights[a];
+  const int64_t grain = std::max<int64_t>(1, 4096 / std::max(row_size, 1));
+  at::parallel_for(0, num_rows, grain, [&](int64_t begin, int64_t end) {
+    std::vector<float> buf(row_size);
+    for (int64_t row = begin; row < end; row++) {
+      float *out = output + row * row_size;
+      std::fill(out, out + row_size, 0.f);
+      for (int a = 0; a < num_augs; a++) {
+        load(a, row, buf.data());
+        for (int i = 0; i < row_size; i++) out[i] += weights[a] * buf[i];
+      }
+      for (int i = 0; i < row_size; i++) out[i] /= weight_sum;
+    }
+  });
+}
+
+static void check_augs(const std::vector<at::Tensor> &values,
+                       const at::Tensor &weights, const at::Tensor &output) {
+  AT_CHECK(!values.empty(), "there must be at least one augmentation");
+  AT_CHECK(weights.numel() == static_cast<int64_t>(values.size()),
+           "weights must have one element per augmentation");
+  for (const at::Tensor &v : values) {
+    CHECK_INPUT(v);
+    CHECK_FLOAT(v);
+    AT_CHECK(v.sizes() == output.sizes(),
+             "all augmentations must have the shape of the output");
+  }
+}
+
+// bboxes: num_augs tensors of shape (n, 4 * k) at the augmented scales
+// meta: (num_augs, 6), see above
+// output: (n, 4 * k), the weighted mean of the mapped back bboxes
+int map_back_mean(const std::vector<at::Tensor> &bboxes, at::Tensor meta,
+                  at::Tensor weights, at::Tensor output) {
+  CHECK_INPUT(meta);
+  CHECK_INPUT(weights);
+  CHECK_INPUT(output);
+  CHECK_FLOAT(meta);
+  CHECK_FLOAT(weights);
+  CHECK_FLOAT(output);
+  check_augs(bboxes, weights, output);
+  AT_CHECK(meta.size(0) == static_cast<int64_t>(bboxes.size()) &&
+               meta.size(1) == META_SIZE,
+           "meta must be of shape (num_augs, 6)");
+  if (output.numel() == 0) return 1;
+
+  const int row_size = output.size(1);
+  std::vector<const float *> src;
+  for (const at::Tensor &b : bboxes) src.push_back(b.data<float>());
+  const float *meta_data = meta.data<float>();
+  mean_rows(bboxes.size(), output.size(0), row_size, weights.data<float>(),
+            [&](int a, int64_t row, float *buf) {
+              map_back_row(src[a] + row * row_size, row_size,
+                           meta_data + a * META_SIZE, buf);
+            },
+            output.data<float>());
+  return 1;
+}
+
+// values: num_augs tensors of the shape of the output, e.g. (n, #class) scores
+// or (n, #class, h, w) masks
+// flips: (num_augs) uint8, the last dimension of flipped augmentations is
+// reversed first
+// output: the weighted mean of the values
+int flip_mean(const std::vector<at::Tensor> &values, at::Tensor flips,
+              at::Tensor weights, at::Tensor output) {
+  CHECK_INPUT(flips);
+  CHECK_INPUT(weights);
+  CHECK_INPUT(output);
+  CHECK_FLOAT(weights);
+  CHECK_FLOAT(output);
+  AT_CHECK(flips.type().scalarType() == at::kByte, "flips must be uint8");
+  AT_CHECK(flips.numel() == static_cast<int64_t>(values.size()),
+           "flips must have one element per augmentation");
+  check_augs(values, weights, output);
+  if (output.numel() == 0) return 1;
+
+  const int row_size = output.size(output.dim() - 1);
+  std::vector<const float *> src;
+  for (const at::Tensor &v : values) src.push_back(v.data<float>());
+  const uint8_t *flip_data = flips.data<uint8_t>();
+  mean_rows(values.size(), output.numel() / row_size, row_size,
+            weights.data<float>(),
+            [&](int a, int64_t row, float *buf) {
+              const float *s = src[a] + row * row_size;
+              if (flip_data[a]) {
+                std::reverse_copy(s, s + row_size, buf);
+              } else {
+                std::copy(s, s + row_size, buf);
+              }
+            },
+            output.data<float>());
+  return 1;
+}
+
+// Greedy NMS over candidate rows sorted by decreasing score, with the
+// arithmetic of cpu_nms. Returns the kept rows in order.
+static std::vector<int> nms_rows(const float *bboxes, const int stride,
+                                 const std::vector<int> &order,
+                                 const double iou_thr) {
+  const int num = order.size();
+  std::vector<float> x1(num), y1(num), x2(num), y2(num), areas(num);
+  for (int i = 0; i < num; i++) {
+    const float *b = bboxes + static_cast<int64_t>(order[i]) * stride;
+    x1[i] = b[0];
+    y1[i] = b[1];
+    x2[i] = b[2];
+    y2[i] = b[3];
+    areas[i] = (x2[i] - x1[i] + 1) * (y2[i] - y1[i] + 1);
+  }
+  std::vector<char> suppressed(num, 0);
+  std::vector<int> keep;
+  for (int i = 0; i < num; i++) {
+    if (suppressed[i]) continue;
+    keep.push_back(order[i]);
+    for (int j = i + 1; j < num; j++) {
+      if (suppressed[j]) continue;
+      const float w =
+          std::max(0.f, std::min(x2[i], x2[j]) - std::max(x1[i], x1[j]) + 1);
+      const float h =
+          std::max(0.f, std::min(y2[i], y2[j]) - std::max(y1[i], y1[j]) + 1);
+      const float inter = w * h;
+      const float ovr = inter / (areas[i] + areas[j] - inter);
+      if (ovr >= iou_thr) suppressed[j] = 1;
+    }
+  }
+  return keep;
+}
+
+// Rows of a score column above score_thr, sorted by decreasing score.
+static std::vector<int> sorted_candidates(const float *scores,
+                                          const int64_t num_rows,
+                                          const int stride,
+                                          const float score_thr) {
+  std::vector<int> order;
+  for (int64_t i = 0; i < num_rows; i++) {
+    if (scores[i * stride] > score_thr) order.push_back(i);
+  }
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    return scores[a * stride] > scores[b * stride];
+  });
+  return order;
+}
+
+// Same as multiclass_nms: class 0 is the background, every other class is
+// suppressed separately and the results are concatenated in class order,
+// keeping the max_num best detections if there are more (max_num < 0 keeps
+// all of them). The classes are suppressed in parallel.
+// bboxes: (n, 4) or (n, 4 * #class), scores: (n, #class)
+// returns (dets, labels) of shape (k, 5) and (k), labels are 0-based
+std::vector<at::Tensor> multiclass_nms(at::Tensor bboxes, at::Tensor scores,
+                                       float score_thr, double iou_thr,
+                                       int max_num) {
+  CHECK_INPUT(bboxes);
+  CHECK_INPUT(scores);
+  CHECK_FLOAT(bboxes);
+  CHECK_FLOAT(scores);
+  const int64_t num_rows = scores.size(0);
+  const int num_classes = scores.size(1);
+  const int box_stride = bboxes.size(1);
+  AT_CHECK(bboxes.size(0) == num_rows &&
+               (box_stride == 4 || box_stride == 4 * num_classes),
+           "bboxes must be of shape (n, 4) or (n, 4 * #class)");
+
+  const float *box_data = bboxes.data<float>();
+  const float *score_data = scores.data<float>();
+  std::vector<std::vector<int>> keep(num_classes);
+  if (num_rows > 0 && num_classes > 1) {
+    std::vector<std::vector<int>> order(num_classes);
+    std::vector<int64_t> cost(num_classes - 1);
+    at::parallel_for(1, num_classes, 1, [&](int64_t begin, int64_t end) {
+      for (int64_t c = begin; c < end; c++) {
+        order[c] = sorted_candidates(score_data + c, num_rows, num_classes,
+                                     score_thr);
+        cost[c - 1] = static_cast<int64_t>(order[c].size()) * order[c].size();
+      }
+    });
+    parallel_for_cost(cost, [&](int64_t item) {
+      const int c = item + 1;
+      keep[c] = nms_rows(box_data + (box_stride == 4 ? 0 : c * 4), box_stride,
+                         order[c], iou_thr);
+    });
+  }
+
+  // (class, row) of the detections in class order
+  std::vector<std::pair<int, int>> dets;
+  for (int c = 1; c < num_classes; c++) {
+    for (const int row : keep[c]) dets.emplace_back(c, row);
+  }
+  if (max_num >= 0 && static_cast<int>(dets.size()) > max_num) {
+    std::stable_sort(dets.begin(), dets.end(),
+                     [&](const std::pair<int, int> &a,
+                         const std::pair<int, int> &b) {
+                       return score_data[a.second * num_classes + a.first] >
+                              score_data[b.second * num_classes + b.first];
+                     });
+    dets.resize(max_num);
+  }
+
+  const int64_t num_dets = dets.size();
+  at::Tensor det_bboxes = at::empty({num_dets, 5}, bboxes.type());
+  at::Tensor det_labels =
+      at::empty({num_dets}, bboxes.type().toScalarType(at::kLong));
+  float *det_data = det_bboxes.data<float>();
+  int64_t *label_data = det_labels.data<int64_t>();
+  for (int64_t i = 0; i < num_dets; i++) {
+    const int c = dets[i].first;
+    const int64_t row = dets[i].second;
+    const float *b =
+        box_data + row * box_stride + (box_stride == 4 ? 0 : c * 4);
+    std::copy(b, b + 4, det_data + i * 5);
+    det_data[i * 5 + 4] = score_data[row * num_classes + c];
+    label_data[i] = c - 1;
+  }
+  return {det_bboxes, det_labels};
+}
+
+// Merges bboxes and scores of the augmentations and suppresses them in a
+// single call: map_back_mean, flip_mean (without flips) and multiclass_nms.
+std::vector<at::Tensor> merge_dets(const std::vector<at::Tensor> &bboxes,
+                                   const std::vector<at::Tensor> &scores,
+                                   at::Tensor meta, at::Tensor weights,
+                                   float score_thr, double iou_thr,
+                                   int max_num) {
+  AT_CHECK(!bboxes.empty() && bboxes.size() == scores.size(),
+           "bboxes and scores must be given for every augmentation");
+  at::Tensor merged_bboxes = at::empty(bboxes[0].sizes(), bboxes[0].type());
+  at::Tensor merged_scores = at::empty(scores[0].sizes(), scores[0].type());
+  at::Tensor no_flips =
+      at::zeros({static_cast<int64_t>(scores.size())},
+                scores[0].type().toScalarType(at::kByte));
+  map_back_mean(bboxes, meta, weights, merged_bboxes);
+  flip_mean(scores, no_flips, weights, merged_scores);
+  return multiclass_nms(merged_bboxes, merged_scores, score_thr, iou_thr,
+                        max_num);
+}
+
+// Maps the proposals of the augmentations back to the original image,
+// concatenates and suppresses them and keeps the max_num best ones.
+// proposals: num_augs tensors of shape (n_i, 5)
+// returns the merged proposals of shape (k, 5), by decreasing score
+at::Tensor merge_proposals(const std::vector<at::Tensor> &proposals,
+                           at::Tensor meta, double iou_thr, int max_num) {
+  CHECK_INPUT(meta);
+  CHECK_FLOAT(meta);
+  AT_CHECK(!proposals.empty(), "there must be at least one augmentation");
+  AT_CHECK(meta.size(0) == static_cast<int64_t>(proposals.size()) &&
+               meta.size(1) == META_SIZE,
+           "meta must be of shape (num_augs, 6)");
+  std::vector<int64_t> start(1, 0);
+  for (const at::Tensor &p : proposals) {
+    CHECK_INPUT(p);
+    CHECK_FLOAT(p);
+    AT_CHECK(p.dim() == 2 && p.size(1) == 5,
+             "proposals must be of shape (n, 5)");
+    start.push_back(start.back() + p.size(0));
+  }
+
+  const int num_augs = proposals.size();
+  const int64_t num_rows = start.back();
+  at::Tensor all = at::empty({num_rows, 5}, proposals[0].type());
+  float *all_data = all.data<float>();
+  const float *meta_data = meta.data<float>();
+  at::parallel_for(0, num_augs, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t a = begin; a < end; a++) {
+      const float *src = proposals[a].data<float>();
+      for (int64_t i = 0; i < start[a + 1] - start[a]; i++) {
+        map_back_row(src + i * 5, 5, meta_data + a * META_SIZE,
+                     all_data + (start[a] + i) * 5);
+      }
+    }
+  });
+
+  std::vector<int> order(num_rows);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    return all_data[a * 5 + 4] > all_data[b * 5 + 4];
+  });
+  std::vector<int> keep = nms_rows(all_data, 5, order, iou_thr);
+  if (max_num >= 0 && static_cast<int>(keep.size()) > max_num) {
+    keep.resize(max_num);
+  }
+
+  at::Tensor merged =
+      at::empty({static_cast<int64_t>(keep.size()), 5}, all.type());
+  float *merged_data = merged.data<float>();
+  for (size_t i = 0; i < keep.size(); i++) {
+    std::copy(all_data + keep[i] * 5, all_data + keep[i] * 5 + 5,
+              merged_data + i * 5);
+  }
+  return merged;
+}
+
+PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
+  m.def("map_back_mean", &map_back_mean,
+        "weighted mean of bboxes mapped back to the original image (CPU)",
+        py::call_guard<py::gil_scoped_release>());
+  m.def("flip_mean", &flip_mean,
+        "weighted mean of optionally flipped scores or masks (CPU)",
+        py::call_guard<py::gil_scoped_release>());
+  m.def("multiclass_nms", &multiclass_nms,
+        "multi-class NMS with the classes in parallel (CPU)",
+        py::call_guard<py::gil_scoped_release>());
+  m.def("merge_dets", &merge_dets,
+        "merge and suppress the bboxes of all augmentations (CPU)",
+        py::call_guard<py::gil_scoped_release>());
+  m.def("merge_proposals", &merge_proposals,
+        "merge and suppress the proposals of all augmentations (CPU)",
+        py::call_guard<py::gil_scoped_release>());
+}
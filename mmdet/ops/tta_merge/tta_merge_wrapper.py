@@ -0,0 +1,87 @@
+import numpy as np
+import torch
+
+from . import tta_merge_cpu
+
+
+def aug_meta(img_metas):
+    """Pack the image meta of the augmentations into the (num_augs, 6) float
+    tensor of the native op: [flip, img_width, scale_factor x 4]."""
+    meta = torch.empty((len(img_metas), 6), dtype=torch.float32)
+    for i, img_info in enumerate(img_metas):
+        meta[i, 0] = float(img_info['flip'])
+        meta[i, 1] = img_info['img_shape'][1]
+        meta[i, 2:] = torch.from_numpy(
+            np.broadcast_to(
+                np.asarray(img_info['scale_factor'], dtype=np.float32),
+                (4, )).copy())
+    return meta
+
+
+def _weights(weights, num_augs):
+    if weights is None:
+        return torch.ones(num_augs, dtype=torch.float32)
+    assert len(weights) == num_augs
+    return torch.tensor(weights, dtype=torch.float32)
+
+
+def _cpu(tensors):
+    return [t.detach().float().cpu().contiguous() for t in tensors]
+
+
+def merge_mapped_bboxes(aug_bboxes, meta, weights=None):
+    """Weighted mean of the bboxes of the augmentations, mapped back to the
+    original image. The result is on the device of the inputs."""
+    output = torch.empty(aug_bboxes[0].shape, dtype=torch.float32)
+    tta_merge_cpu.map_back_mean(
+        _cpu(aug_bboxes), meta, _weights(weights, len(aug_bboxes)), output)
+    return output.to(aug_bboxes[0].device)
+
+
+def merge_maps(aug_maps, flips=None, weights=None):
+    """Weighted mean of scores or masks (Tensors or ndarrays), the last
+    dimension of the flipped ones is reversed first."""
+    is_tensor = isinstance(aug_maps[0], torch.Tensor)
+    maps = aug_maps if is_tensor else [
+        torch.from_numpy(np.ascontiguousarray(m, dtype=np.float32))
+        for m in aug_maps
+    ]
+    if flips is None:
+        flips = [False] * len(aug_maps)
+    output = torch.empty(maps[0].shape, dtype=torch.float32)
+    tta_merge_cpu.flip_mean(
+        _cpu(maps), torch.tensor(flips, dtype=torch.uint8),
+        _weights(weights, len(aug_maps)), output)
+    return output.to(aug_maps[0].device) if is_tensor else output.numpy()
+
+
+def multiclass_nms(multi_bboxes, multi_scores, score_thr, iou_thr,
+                   max_num=-1):
+    """Native counterpart of :func:`mmdet.core.multiclass_nms` with a plain
+    NMS, the classes are suppressed in parallel."""
+    dets, labels = tta_merge_cpu.multiclass_nms(
+        *_cpu([multi_bboxes, multi_scores]), score_thr, iou_thr, max_num)
+    return dets.to(multi_bboxes.device), labels.to(multi_bboxes.device)
+
+
+def merge_dets(aug_bboxes, aug_scores, meta, score_thr, iou_thr, max_num=-1,
+               weights=None):
+    """Map back, average and suppress the detections of all augmentations in
+    a single native call.
+
+    Returns:
+        tuple: (bboxes, labels), tensors of shape (k, 5) and (k, ) on the
+            device of the inputs, as returned by multiclass_nms.
+    """
+    dets, labels = tta_merge_cpu.merge_dets(
+        _cpu(aug_bboxes), _cpu(aug_scores), meta,
+        _weights(weights, len(aug_bboxes)), score_thr, iou_thr, max_num)
+    return dets.to(aug_bboxes[0].device), labels.to(aug_bboxes[0].device)
+
+
+def merge_proposals(aug_proposals, meta, iou_thr, max_num):
+    """Map back, concatenate and suppress the (n, 5) proposals of all
+    augmentations, keeping the ``max_num`` best ones."""
+    proposals = tta_merge_cpu.merge_proposals(
+        _cpu(aug_proposals), meta, iou_thr, max_num)
+    return proposals.to(aug_proposals[0].device)
@@ -0,0 +1,80 @@
+import argparse
+
+import numpy as np
+import torch
+import mmcv
+
+from mmdet.models import build_detector
+from mmdet.ops.autotune import autotuner
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description='Tune the launch parameters of the ops offline')
+    parser.add_argument('configs', nargs='+', help='test config files')
+    parser.add_argument(
+        '--img-scale',
+        type=int,
+        nargs=2,
+        action='append',
+        help='(w, h) test scales, defaults to the ones of the configs')
+    parser.add_argument(
+        '--cache', help='cache file, defaults to $MMDET_AUTOTUNE_CACHE')
+    parser.add_argument(
+        '--cpu', action='store_true', help='tune the CPU kernels')
+    args = parser.parse_args()
+    return args
+
+
+def dummy_inputs(scale, size_divisor, device):
+    """A random image of a test scale, resized and padded like the test
+    pipeline does (the weights are random too, only the shapes matter)."""
+    w, h = scale
+    pad_h = int(np.ceil(h / size_divisor)) * size_divisor
+    pad_w = int(np.ceil(w / size_divisor)) * size_divisor
+    img = torch.randn(1, 3, pad_h, pad_w, device=device)
+    img_meta = dict(
+        ori_shape=(h, w, 3),
+        img_shape=(h, w, 3),
+        pad_shape=(pad_h, pad_w, 3),
+        scale_factor=1.0,
+        flip=False)
+    return img, img_meta
+
+
+def main():
+    args = parse_args()
+    if args.cache is not None:
+        autotuner.cache_file = args.cache
+    autotuner.enabled = True
+    device = 'cpu' if args.cpu else 'cuda'
+
+    for config in args.configs:
+        cfg = mmcv.Config.fromfile(config)
+        cfg.model.pretrained = None
+        model = build_detector(
+            cfg.model, train_cfg=None, test_cfg=cfg.test_cfg)
+        model = model.to(device).eval()
+
+        test_cfg = cfg.data.test
+        scales = args.img_scale or test_cfg.img_scale
+        if isinstance(scales[0], int):
+            scales = [scales]
+        size_divisor = test_cfg.get('size_divisor', None) or 1
+        for scale in scales:
+            print('tuning {} at {}'.format(config, tuple(scale)))
+            img, img_meta = dummy_inputs(scale, size_divisor, device)
+            with torch.no_grad():
+                model(
+                    img=[img],
+                    img_meta=[[img_meta]],
+                    return_loss=False,
+                    rescale=True)
+
+    # new entries are otherwise only saved at exit
+    autotuner.save()
+    print('tuned configurations saved to {}'.format(autotuner.cache_file))
+
+
+if __name__ == '__main__':
+    main()
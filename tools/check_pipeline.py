@@ -0,0 +1,92 @@
+"""Check that pipelined_test gives the same results as a sequential loop over
+the first images of the test set."""
+import argparse
+
+import mmcv
+import numpy as np
+import torch
+from mmcv.parallel import MMDataParallel
+from mmcv.runner import load_checkpoint, obj_from_dict
+from torch.utils.data import Subset
+
+from mmdet import datasets
+from mmdet.apis import pipelined_test
+from mmdet.datasets import build_dataloader
+from mmdet.models import build_detector
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description='Compare pipelined and sequential testing')
+    parser.add_argument('config', help='test config file path')
+    parser.add_argument('checkpoint', help='checkpoint file')
+    parser.add_argument(
+        '--num_imgs', default=50, type=int, help='images to compare')
+    parser.add_argument(
+        '--infer_workers',
+        default=2,
+        type=int,
+        help='threads running the model')
+    parser.add_argument(
+        '--post_workers',
+        default=2,
+        type=int,
+        help='threads running the post-processing')
+    return parser.parse_args()
+
+
+def check_equal(expected, actual, where):
+    assert type(expected) is type(actual), '{}: {} vs {}'.format(
+        where, type(expected), type(actual))
+    if isinstance(expected, np.ndarray):
+        assert np.array_equal(expected, actual), '{} differs'.format(where)
+    elif isinstance(expected, (tuple, list)):
+        assert len(expected) == len(actual), '{}: length'.format(where)
+        for i, (e, a) in enumerate(zip(expected, actual)):
+            check_equal(e, a, '{}[{}]'.format(where, i))
+    elif isinstance(expected, dict):
+        assert set(expected) == set(actual), '{}: keys'.format(where)
+        for k in expected:
+            check_equal(expected[k], actual[k], '{}[{!r}]'.format(where, k))
+    else:
+        assert expected == actual, '{} differs'.format(where)
+
+
+def main():
+    args = parse_args()
+    cfg = mmcv.Config.fromfile(args.config)
+    # the same kernels must be used by both runs
+    torch.backends.cudnn.benchmark = False
+    cfg.model.pretrained = None
+    dataset = obj_from_dict(cfg.data.test, datasets, dict(test_mode=True))
+    dataset = Subset(dataset, range(min(args.num_imgs, len(dataset))))
+    model = build_detector(cfg.model, train_cfg=None, test_cfg=cfg.test_cfg)
+    load_checkpoint(model, args.checkpoint)
+    model = MMDataParallel(model, device_ids=[0])
+    model.eval()
+
+    def data_loader():
+        return build_dataloader(
+            dataset,
+            imgs_per_gpu=1,
+            workers_per_gpu=cfg.data.workers_per_gpu,
+            num_gpus=1,
+            dist=False,
+            shuffle=False)
+
+    expected = []
+    for data in data_loader():
+        with torch.no_grad():
+            expected.append(model(return_loss=False, rescale=True, **data))
+    results = pipelined_test(
+        model,
+        data_loader(),
+        infer_workers=args.infer_workers,
+        post_workers=args.post_workers)
+    for i, (e, a) in enumerate(zip(expected, results)):
+        check_equal(e, a, 'image {}'.format(i))
+    print('pipelined results of {} images: OK'.format(len(expected)))
+
+
+if __name__ == '__main__':
+    main()
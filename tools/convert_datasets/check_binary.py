@@ -0,0 +1,150 @@
+"""Check that the binary format round-trips annotations and proposals.
+
+Without arguments, random annotations (including images without boxes,
+without ignore boxes and without the ``ann`` field) are converted and
+compared. With a source file and the converted ``.bin`` file, the two are
+compared instead.
+"""
+import argparse
+import os.path as osp
+import tempfile
+
+import mmcv
+import numpy as np
+
+from mmdet.datasets import CustomDataset
+from mmdet.datasets.binary_ann import (dump_binary_annotations,
+                                       dump_binary_proposals)
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description='Check the round trip of the binary annotation format')
+    parser.add_argument('in_file', nargs='?', help='pickle or json file')
+    parser.add_argument('bin_file', nargs='?', help='converted .bin file')
+    parser.add_argument(
+        '--type',
+        choices=['ann', 'proposal'],
+        default='ann',
+        help='content of the files')
+    return parser.parse_args()
+
+
+def _check_array(expected, actual, name):
+    expected = np.asarray(expected)
+    actual = np.asarray(actual)
+    assert expected.size == actual.size, '{}: {} vs {} elements'.format(
+        name, expected.size, actual.size)
+    assert np.array_equal(
+        expected.reshape(actual.shape).astype(actual.dtype),
+        actual), '{} differs'.format(name)
+
+
+def check_img_info(expected, actual, idx):
+    for key in ('filename', 'width', 'height'):
+        assert expected[key] == actual[key], '{} of image {}: {} vs {}'.format(
+            key, idx, expected[key], actual[key])
+    assert ('ann' in expected) == ('ann' in actual)
+    if 'ann' not in expected:
+        return
+    ann, ann_bin = expected['ann'], actual['ann']
+    assert set(ann.keys()) == set(ann_bin.keys()), 'fields of image {}'.format(
+        idx)
+    for key in ann:
+        _check_array(ann[key], ann_bin[key], '{} of image {}'.format(key, idx))
+
+
+def check_dataset(expected, bin_file, kind='ann'):
+    """Load a .bin file as CustomDataset does and compare it with the source,
+    as a whole and through the subset kept after filtering."""
+    load = (CustomDataset.load_annotations
+            if kind == 'ann' else CustomDataset.load_proposals)
+    loaded = load(None, bin_file)
+    assert len(loaded) == len(expected)
+    rng = np.random.RandomState(0)
+    inds = np.sort(rng.choice(len(expected), len(expected) // 2,
+                              replace=False)).tolist()
+    subset = CustomDataset._subset(loaded, inds)
+    # a subset of a subset, as after filtering twice
+    sub_inds = list(range(0, len(inds), 2))
+    subsubset = CustomDataset._subset(subset, sub_inds)
+    pairs = [(expected[i], loaded[i], i) for i in range(len(expected))]
+    pairs += [(expected[i], subset[j], i) for j, i in enumerate(inds)]
+    pairs += [(expected[inds[k]], subsubset[j], inds[k])
+              for j, k in enumerate(sub_inds)]
+    for exp, act, idx in pairs:
+        if kind == 'ann':
+            check_img_info(exp, act, idx)
+        else:
+            _check_array(exp, act, 'proposals of image {}'.format(idx))
+
+
+def random_annotations(num_imgs, rng, with_ann=True):
+    img_infos = []
+    for i in range(num_imgs):
+        img_info = dict(
+            filename='images/{:06d}_é.jpg'.format(i),
+            width=int(rng.randint(1, 2000)),
+            height=int(rng.randint(1, 2000)))
+        if with_ann:
+            # every third image has no boxes, every other one no ignore
+            # boxes
+            num = 0 if i % 3 == 0 else rng.randint(1, 20)
+            num_ignore = 0 if i % 2 == 0 else rng.randint(1, 5)
+            img_info['ann'] = dict(
+                bboxes=rng.rand(num, 4).astype(np.float32) * 1000,
+                labels=rng.randint(1, 81, num).astype(np.int64),
+                bboxes_ignore=rng.rand(num_ignore, 4).astype(np.float32),
+                labels_ignore=rng.randint(1, 81,
+                                          num_ignore).astype(np.int64))
+        img_infos.append(img_info)
+    return img_infos
+
+
+def self_check():
+    rng = np.random.RandomState(0)
+    tmp_dir = tempfile.mkdtemp()
+    no_ignore = random_annotations(20, rng)
+    for img_info in no_ignore:
+        del img_info['ann']['bboxes_ignore'], img_info['ann']['labels_ignore']
+    cases = [
+        ('annotations', random_annotations(50, rng), 'ann'),
+        ('annotations without ignore boxes', no_ignore, 'ann'),
+        ('test annotations', random_annotations(20, rng, False), 'ann'),
+        ('proposals', [
+            rng.rand(0 if i % 4 == 0 else rng.randint(1, 300), 5).astype(
+                np.float32) for i in range(30)
+        ], 'proposal'),
+    ]
+    for name, data, kind in cases:
+        bin_file = osp.join(tmp_dir, '{}.bin'.format(name.replace(' ', '_')))
+        if kind == 'ann':
+            dump_binary_annotations(data, bin_file)
+        else:
+            dump_binary_proposals(data, bin_file)
+        check_dataset(data, bin_file, kind)
+        print('{}: OK'.format(name))
+
+    # fields missing in some images are rejected instead of dropped
+    mixed = random_annotations(4, rng)
+    del mixed[1]['ann']['bboxes_ignore'], mixed[1]['ann']['labels_ignore']
+    try:
+        dump_binary_annotations(mixed, osp.join(tmp_dir, 'mixed.bin'))
+    except ValueError:
+        print('mixed ignore fields: OK')
+    else:
+        raise AssertionError('mixed ignore fields were not rejected')
+
+
+def main():
+    args = parse_args()
+    if args.in_file is None:
+        self_check()
+    else:
+        assert args.bin_file is not None, 'the .bin file is missing'
+        check_dataset(mmcv.load(args.in_file), args.bin_file, args.type)
+        print('OK')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,44 @@
+import argparse
+import os.path as osp
+
+import mmcv
+
+from mmdet.datasets.binary_ann import (dump_binary_annotations,
+                                       dump_binary_proposals)
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description='Convert annotations or proposals of mmdetection format '
+        'to the memory-mapped binary format')
+    parser.add_argument('in_file', help='input pickle or json file')
+    parser.add_argument(
+        '-o', '--out-file', help='output path (default: <in_file>.bin)')
+    parser.add_argument(
+        '--type',
+        choices=['ann', 'proposal'],
+        default='ann',
+        help='content of the input file')
+    args = parser.parse_args()
+    return args
+
+
+def main():
+    args = parse_args()
+    out_file = args.out_file
+    if out_file is None:
+        out_file = osp.splitext(args.in_file)[0] + '.bin'
+    if not out_file.endswith('.bin'):
+        raise ValueError('The output file must be a ".bin" file')
+    print('loading {} ...'.format(args.in_file))
+    data = mmcv.load(args.in_file)
+    print('writing {} ...'.format(out_file))
+    if args.type == 'ann':
+        dump_binary_annotations(data, out_file)
+    else:
+        dump_binary_proposals(data, out_file)
+    print('Done!')
+
+
+if __name__ == '__main__':
+    main()
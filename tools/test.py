@@ -6,6 +6,7 @@ from mmcv.runner import load_checkpoint, parallel_test, obj_from_dict
 from mmcv.parallel import scatter, collate, MMDataParallel
 
 from mmdet import datasets
+from mmdet.apis import pipelined_test
 from mmdet.core import results2json, coco_eval
 from mmdet.datasets import build_dataloader
 from mmdet.models import build_detector, detectors
@@ -55,6 +56,30 @@ def parse_args():
         choices=['proposal', 'proposal_fast', 'bbox', 'segm', 'keypoints'],
         help='eval types')
     parser.add_argument('--show', action='store_true', help='show results')
+    parser.add_argument(
+        '--pipeline',
+        action='store_true',
+        help='overlap data loading, inference and post-processing '
+        '(single GPU), with the same results')
+    parser.add_argument(
+        '--load_workers',
+        type=int,
+        help='data loader workers, defaults to workers_per_gpu')
+    parser.add_argument(
+        '--infer_workers',
+        default=1,
+        type=int,
+        help='threads running the model with --pipeline')
+    parser.add_argument(
+        '--post_workers',
+        default=2,
+        type=int,
+        help='threads running the post-processing with --pipeline')
+    parser.add_argument(
+        '--queue_size',
+        default=4,
+        type=int,
+        help='images buffered between two stages with --pipeline')
     args = parser.parse_args()
     return args
 
@@ -64,6 +89,9 @@ def main():
 
     if args.out is not None and not args.out.endswith(('.pkl', '.pickle')):
         raise ValueError('The output file must be a pkl file.')
+    if args.pipeline and (args.show or args.gpus != 1):
+        raise ValueError('--pipeline supports single GPU testing without '
+                         '--show only.')
 
     cfg = mmcv.Config.fromfile(args.config)
     # set cudnn_benchmark
@@ -79,14 +107,24 @@ def main():
         load_checkpoint(model, args.checkpoint)
         model = MMDataParallel(model, device_ids=[0])
 
+        load_workers = (args.load_workers if args.load_workers is not None
+                        else cfg.data.workers_per_gpu)
         data_loader = build_dataloader(
             dataset,
             imgs_per_gpu=1,
-            workers_per_gpu=cfg.data.workers_per_gpu,
+            workers_per_gpu=load_workers,
             num_gpus=1,
             dist=False,
             shuffle=False)
-        outputs = single_test(model, data_loader, args.show)
+        if args.pipeline:
+            outputs = pipelined_test(
+                model,
+                data_loader,
+                infer_workers=args.infer_workers,
+                post_workers=args.post_workers,
+                queue_size=args.queue_size)
+        else:
+            outputs = single_test(model, data_loader, args.show)
     else:
         model_args = cfg.model.copy()
         model_args.update(train_cfg=None, test_cfg=cfg.test_cfg)